@@ -6,165 +6,495 @@
 
 using GLTF::Constants::WebGL;
 
-GLTF::BufferView *AccessorPacker::packAccessorsForTargetByteStride(
-    const std::vector<GLTF::Accessor *> &accessors, WebGL target) {
-    std::map<GLTF::Accessor *, int> byteOffsets;
-    int byteLength = 0;
+static size_t alignedOffset(const size_t offset, const size_t alignment) {
+    const auto padding = offset % alignment;
+    return padding ? offset + alignment - padding : offset;
+}
+
+static size_t elementByteLength(GLTF::Accessor &accessor) {
+    return static_cast<size_t>(accessor.getComponentByteLength()) *
+           accessor.getNumberOfComponents();
+}
+
+std::vector<AccessorPacker::ViewLayout>
+AccessorPacker::computeLayout(const std::vector<GLTF::Accessor *> &accessors,
+                              size_t &byteLength) const {
+    // Group the accessors per target and byte stride, keeping their order.
+    // The accessors that are packed separately get buffer views of their own.
+    std::map<std::tuple<bool, WebGL, int>, std::vector<GLTF::Accessor *>>
+        accessorGroups;
+
+    // The accessors of each interleaved vertex stream.
+    std::map<size_t, std::vector<GLTF::Accessor *>> streams;
+
     for (GLTF::Accessor *accessor : accessors) {
-        const auto componentByteLength = accessor->getComponentByteLength();
-        const auto padding = byteLength % componentByteLength;
-        if (padding != 0) {
-            byteLength += (componentByteLength - padding);
+        // In glTF 2.0, bufferView is not required in accessor.
+        if (accessor->bufferView == nullptr) {
+            continue;
         }
-        byteOffsets[accessor] = byteLength;
-        byteLength += componentByteLength * accessor->getNumberOfComponents() *
-                      accessor->count;
+
+        const auto stream = m_streamIndices.find(accessor);
+        if (stream != m_streamIndices.end()) {
+            streams[stream->second].push_back(accessor);
+            continue;
+        }
+
+        const auto target = accessor->bufferView->target;
+        const auto byteStride = static_cast<int>(elementByteLength(*accessor));
+        accessorGroups[{isPackedSeparately(accessor), target, byteStride}]
+            .push_back(accessor);
     }
 
-    auto bufferData = new byte[byteLength];
-    m_data.emplace_back(bufferData);
+    std::vector<ViewLayout> views;
 
-    const auto bufferView =
-        new GLTF::BufferView(bufferData, byteLength, target);
-    m_views.emplace_back(bufferView);
+    for (auto &stream : streams) {
+        auto &streamAccessors = stream.second;
 
-    for (GLTF::Accessor *accessor : accessors) {
-        const auto byteOffset = byteOffsets[accessor];
-        GLTF::Accessor packedAccessor(accessor->type, accessor->componentType,
-                                      byteOffset, accessor->count, bufferView);
+        // Each element of a vertex attribute must be aligned to 4 bytes.
+        ViewLayout view;
+        view.target = WebGL::ARRAY_BUFFER;
+        view.isInterleaved = true;
+        view.accessors = streamAccessors;
+
+        size_t vertexByteLength = 0;
+        for (GLTF::Accessor *accessor : streamAccessors) {
+            view.accessorByteOffsets.push_back(vertexByteLength);
+            vertexByteLength += alignedOffset(elementByteLength(*accessor), 4);
+        }
+
+        // A single accessor, or a stride that glTF doesn't allow, is packed
+        // like any other accessor.
+        if (streamAccessors.size() < 2 || vertexByteLength > 252) {
+            for (GLTF::Accessor *accessor : streamAccessors) {
+                const auto byteStride =
+                    static_cast<int>(elementByteLength(*accessor));
+                accessorGroups[{false, WebGL::ARRAY_BUFFER, byteStride}]
+                    .push_back(accessor);
+            }
+            continue;
+        }
 
-        const size_t numberOfComponents = accessor->getNumberOfComponents();
+        view.byteStride = static_cast<int>(vertexByteLength);
+        view.byteLength = vertexByteLength *
+                          static_cast<size_t>(streamAccessors.front()->count);
+
+        views.emplace_back(std::move(view));
+    }
 
-        const auto components =
-            static_cast<float *>(alloca(sizeof(float) * numberOfComponents));
+    for (auto &group : accessorGroups) {
+        ViewLayout view;
+        view.target = std::get<1>(group.first);
+        view.byteStride = std::get<2>(group.first);
+        view.accessors = std::move(group.second);
+        view.accessorByteOffsets.reserve(view.accessors.size());
 
-        for (auto i = 0; i < accessor->count; i++) {
-            accessor->getComponentAtIndex(i, components);
-            packedAccessor.writeComponentAtIndex(i, components);
+        for (GLTF::Accessor *accessor : view.accessors) {
+            const size_t componentByteLength =
+                accessor->getComponentByteLength();
+            view.byteLength =
+                alignedOffset(view.byteLength, componentByteLength);
+            view.accessorByteOffsets.push_back(view.byteLength);
+            view.byteLength += elementByteLength(*accessor) *
+                               static_cast<size_t>(accessor->count);
         }
 
-        accessor->byteOffset = packedAccessor.byteOffset;
-        accessor->bufferView = packedAccessor.bufferView;
+        views.emplace_back(std::move(view));
     }
-    return bufferView;
+
+    // The buffer views are sorted from largest byte stride to smallest.
+    std::stable_sort(views.begin(), views.end(),
+                     [](const ViewLayout &a, const ViewLayout &b) {
+                         return a.byteStride > b.byteStride;
+                     });
+
+    // Align each buffer view to 4 bytes, as vertex attributes require.
+    byteLength = 0;
+    for (auto &view : views) {
+        view.byteOffset = alignedOffset(byteLength, 4);
+        byteLength = view.byteOffset + view.byteLength;
+    }
+
+    return views;
 }
 
-GLTF::Buffer *
-AccessorPacker::packAccessors(const std::vector<GLTF::Accessor *> &accessors,
-                              const std::string &bufferName,
-                              size_t additionalBufferSize) {
-    std::map<WebGL, std::map<int, std::vector<GLTF::Accessor *>>>
-        accessorGroups;
-    accessorGroups[WebGL::ARRAY_BUFFER] =
-        std::map<int, std::vector<GLTF::Accessor *>>();
-    accessorGroups[WebGL::ELEMENT_ARRAY_BUFFER] =
-        std::map<int, std::vector<GLTF::Accessor *>>();
-    accessorGroups[WebGL(-1)] = std::map<int, std::vector<GLTF::Accessor *>>();
+std::vector<GLTF::Accessor *> AccessorPacker::removeDuplicates(
+    const std::vector<GLTF::Accessor *> &accessors,
+    std::vector<Duplicate> &duplicates) const {
+    std::vector<GLTF::Accessor *> uniqueAccessors;
+    uniqueAccessors.reserve(accessors.size());
+
+    // The first accessors with each content hash. Hashes can collide, so
+    // their content is compared too.
+    std::unordered_map<std::string, std::vector<GLTF::Accessor *>> originals;
 
-    auto byteLength = 0;
     for (GLTF::Accessor *accessor : accessors) {
-        // In glTF 2.0, bufferView is not required in accessor.
         if (accessor->bufferView == nullptr) {
+            uniqueAccessors.push_back(accessor);
             continue;
         }
 
-        WebGL target = accessor->bufferView->target;
-        auto targetGroup = accessorGroups[target];
-        auto byteStride = accessor->getByteStride();
-        auto findByteStrideGroup = targetGroup.find(byteStride);
+        auto &candidates = originals[contentHash(*accessor)];
 
-        std::vector<GLTF::Accessor *> byteStrideGroup =
-            findByteStrideGroup == targetGroup.end()
-                ? std::vector<GLTF::Accessor *>()
-                : findByteStrideGroup->second;
+        const auto original = std::find_if(
+            candidates.begin(), candidates.end(),
+            [this, accessor](GLTF::Accessor *candidate) {
+                // Don't share the buffer view of an accessor that is packed
+                // separately with other accessors.
+                return isPackedSeparately(candidate) ==
+                           isPackedSeparately(accessor) &&
+                       hasSameContent(*candidate, *accessor);
+            });
 
-        byteStrideGroup.push_back(accessor);
-        targetGroup[byteStride] = byteStrideGroup;
-        accessorGroups[target] = targetGroup;
-        byteLength += accessor->bufferView->byteLength;
+        if (original == candidates.end()) {
+            candidates.push_back(accessor);
+            uniqueAccessors.push_back(accessor);
+        } else {
+            duplicates.emplace_back(accessor, *original);
+        }
     }
 
-#if 0
-    // Go through primitives and look for primitives that use Draco extension.
-        // If extension is not enabled, the vector will be empty.
-    std::vector<GLTF::BufferView*> compressedBufferViews = asset->getAllCompressedBufferView();
-    // Reserve data for compressed data.
-    for (GLTF::BufferView* compressedBufferView : compressedBufferViews) {
-        byteLength += compressedBufferView->byteLength;
+    return uniqueAccessors;
+}
+
+std::string AccessorPacker::contentHash(GLTF::Accessor &accessor) {
+    const auto hasher = BufferHasher::create(HashAlgorithm::XXH64);
+
+    const int32_t key[] = {static_cast<int32_t>(accessor.type),
+                           static_cast<int32_t>(accessor.componentType),
+                           static_cast<int32_t>(accessor.count),
+                           static_cast<int32_t>(accessor.bufferView->target)};
+    hasher->process(reinterpret_cast<const byte *>(key), sizeof key);
+
+    const auto elementLength = elementByteLength(accessor);
+    const auto count = static_cast<size_t>(accessor.count);
+
+    size_t sourceStride;
+    const auto *source = sourceData(accessor, sourceStride);
+
+    if (sourceStride == elementLength) {
+        hasher->process(source, elementLength * count);
+    } else {
+        for (size_t index = 0; index < count; ++index) {
+            hasher->process(source + index * sourceStride, elementLength);
+        }
     }
-#endif
 
-    std::vector<int> byteStrides;
-    std::map<int, std::vector<GLTF::BufferView *>> bufferViews;
-    for (auto targetGroup : accessorGroups) {
-        for (auto byteStrideGroup : targetGroup.second) {
-            const WebGL target = targetGroup.first;
-            int byteStride = byteStrideGroup.first;
+    return hasher->hexDigest();
+}
 
-            GLTF::BufferView *bufferView = packAccessorsForTargetByteStride(
-                byteStrideGroup.second, target);
+bool AccessorPacker::hasSameContent(GLTF::Accessor &a, GLTF::Accessor &b) {
+    if (&a == &b)
+        return true;
 
-            if (!bufferName.empty()) {
-                bufferView->name = bufferName + "/" +
-                                   glAccessorTargetPurpose(target) + "-" +
-                                   std::to_string(byteStride);
-            }
+    if (a.type != b.type || a.componentType != b.componentType ||
+        a.count != b.count || a.bufferView->target != b.bufferView->target)
+        return false;
 
-            if (target == WebGL::ARRAY_BUFFER) {
-                bufferView->byteStride = byteStride;
-            }
-            auto findBufferViews = bufferViews.find(byteStride);
-            std::vector<GLTF::BufferView *> bufferViewGroup;
-            if (findBufferViews == bufferViews.end()) {
-                byteStrides.push_back(byteStride);
-                bufferViewGroup = std::vector<GLTF::BufferView *>();
-            } else {
-                bufferViewGroup = findBufferViews->second;
+    const auto elementLength = elementByteLength(a);
+    const auto count = static_cast<size_t>(a.count);
+
+    size_t strideA, strideB;
+    const auto *dataA = sourceData(a, strideA);
+    const auto *dataB = sourceData(b, strideB);
+
+    if (strideA == elementLength && strideB == elementLength)
+        return std::memcmp(dataA, dataB, elementLength * count) == 0;
+
+    for (size_t index = 0; index < count; ++index) {
+        if (std::memcmp(dataA + index * strideA, dataB + index * strideB,
+                        elementLength) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+const byte *AccessorPacker::sourceData(GLTF::Accessor &accessor,
+                                       size_t &byteStride) {
+    const auto *sourceView = accessor.bufferView;
+
+    byteStride = sourceView->byteStride ? sourceView->byteStride
+                                        : elementByteLength(accessor);
+
+    return sourceView->buffer->data + sourceView->byteOffset +
+           accessor.byteOffset;
+}
+
+void AccessorPacker::copyAccessorData(GLTF::Accessor &accessor,
+                                      byte *destination,
+                                      size_t destinationStride) {
+    const auto elementLength = elementByteLength(accessor);
+    const auto count = static_cast<size_t>(accessor.count);
+
+    if (!destinationStride) {
+        destinationStride = elementLength;
+    }
+
+    size_t sourceStride;
+    const auto *source = sourceData(accessor, sourceStride);
+
+    if (sourceStride == elementLength && destinationStride == elementLength) {
+        std::memcpy(destination, source, elementLength * count);
+    } else {
+        // Interleaved source or destination, copy each element.
+        for (size_t index = 0; index < count; ++index) {
+            std::memcpy(destination + index * destinationStride,
+                        source + index * sourceStride, elementLength);
+        }
+    }
+}
+
+std::vector<GLTF::Buffer *>
+AccessorPacker::packAccessors(const std::vector<GLTF::Accessor *> &accessors,
+                              const std::string &bufferName,
+                              size_t additionalBufferSize,
+                              GlbWriter *glbWriter) {
+    std::vector<Duplicate> duplicates;
+    const auto uniqueAccessors = removeDuplicates(accessors, duplicates);
+
+    // A GLB file has only one binary buffer.
+    const auto canSplit = !glbWriter;
+
+    const auto accessorGroups = splitAccessors(
+        uniqueAccessors, bufferName, additionalBufferSize, canSplit);
+
+    std::vector<GLTF::Buffer *> buffers;
+
+    // Only the first group counts the additional bytes, so only the first
+    // buffer reserves these, after its accessors.
+    for (auto &group : accessorGroups) {
+        const auto groupAdditionalSize =
+            &group == &accessorGroups.front() ? additionalBufferSize : 0;
+        const auto buffer =
+            packBuffer(group, bufferName, groupAdditionalSize, glbWriter);
+        if (buffer) {
+            buffers.push_back(buffer);
+        }
+    }
+
+    for (auto &duplicate : duplicates) {
+        duplicate.first->byteOffset = duplicate.second->byteOffset;
+        duplicate.first->bufferView = duplicate.second->bufferView;
+    }
+
+    return buffers;
+}
+
+std::vector<std::vector<GLTF::Accessor *>> AccessorPacker::splitAccessors(
+    const std::vector<GLTF::Accessor *> &accessors,
+    const std::string &bufferName, size_t additionalBufferSize,
+    bool canSplit) const {
+    std::vector<std::vector<GLTF::Accessor *>> groups(1);
+    size_t groupByteLength = additionalBufferSize;
+
+    for (GLTF::Accessor *accessor : accessors) {
+        // An upper bound of the bytes the accessor adds to the buffer,
+        // including the alignment of the accessor and of a new buffer view.
+        // Interleaved elements are aligned to 4 bytes.
+        const auto elementLength =
+            m_streamIndices.count(accessor)
+                ? alignedOffset(elementByteLength(*accessor), 4)
+                : elementByteLength(*accessor);
+
+        const auto byteLength =
+            accessor->bufferView
+                ? elementLength * static_cast<size_t>(accessor->count) + 6
+                : 0;
+
+        if (groupByteLength + byteLength > m_maxBufferByteLength) {
+            if (!canSplit || groups.back().empty()) {
+                std::ostringstream ss;
+                ss << "The buffer '" << bufferName << "' needs more than "
+                   << m_maxBufferByteLength << " bytes"
+                   << (canSplit ? ", even for the single accessor '" +
+                                      accessor->name + "'"
+                                : ", and can't be split over buffers");
+                throw std::runtime_error(ss.str());
             }
-            bufferViewGroup.push_back(bufferView);
-            bufferViews[byteStride] = bufferViewGroup;
+
+            groups.emplace_back();
+            groupByteLength = 0;
         }
+
+        groups.back().push_back(accessor);
+        groupByteLength += byteLength;
     }
-    std::sort(byteStrides.begin(), byteStrides.end(), std::greater<>());
 
-    byteLength += additionalBufferSize;
+    return groups;
+}
+
+GLTF::Buffer *
+AccessorPacker::packBuffer(const std::vector<GLTF::Accessor *> &accessors,
+                           const std::string &bufferName,
+                           size_t additionalBufferSize,
+                           GlbWriter *glbWriter) {
+    size_t dataByteLength = 0;
+    auto views = computeLayout(accessors, dataByteLength);
+
+    const auto byteLength = dataByteLength + additionalBufferSize;
+
+    if (byteLength == 0)
+        return nullptr;
 
-    GLTF::Buffer *buffer = nullptr;
+    std::unique_ptr<MappedOutputFile> mappedFile;
+    if (!glbWriter && !m_mappedFolder.empty()) {
+        mappedFile = MappedOutputFile::tryCreate(m_mappedFolder, byteLength);
+    }
 
-    if (byteLength > 0) {
-        // Pack these into a buffer sorted from largest byteStride to smallest
-        auto bufferData = new byte[byteLength];
+    // Zero initialized, for the padding.
+    byte *bufferData = nullptr;
+    if (mappedFile) {
+        bufferData = mappedFile->data();
+    } else if (!glbWriter) {
+        bufferData = new byte[byteLength]();
         m_data.emplace_back(bufferData);
+    }
+
+    const auto buffer =
+        new GLTF::Buffer(bufferData, static_cast<int>(byteLength));
+    m_buffers.emplace_back(buffer);
+    buffer->name = bufferName;
+
+    if (mappedFile) {
+        m_mappedFiles[buffer] = std::move(mappedFile);
+    }
+
+    std::unique_ptr<BufferHasher> hasher;
+    size_t hashedLength = 0;
+    if (m_isHashing && bufferData) {
+        hasher = BufferHasher::create(m_hashAlgorithm);
+    }
+
+    for (auto &view : views) {
+        const auto bufferView =
+            new GLTF::BufferView(static_cast<int>(view.byteOffset),
+                                 static_cast<int>(view.byteLength), buffer);
+        m_views.emplace_back(bufferView);
+
+        bufferView->target = view.target;
+
+        if (view.target == WebGL::ARRAY_BUFFER) {
+            bufferView->byteStride = view.byteStride;
+        }
+
+        if (!bufferName.empty()) {
+            bufferView->name = bufferName + "/" +
+                               glAccessorTargetPurpose(view.target) +
+                               (view.isInterleaved ? "-interleaved-" : "-") +
+                               std::to_string(view.byteStride);
+        }
+
+        if (view.isInterleaved) {
+            // Each accessor adds an element to each vertex of the view.
+            byte *viewData = nullptr;
+            if (bufferData) {
+                viewData = bufferData + view.byteOffset;
+            } else {
+                viewData = new byte[view.byteLength]();
+                m_data.emplace_back(viewData);
+            }
+
+            for (size_t index = 0; index < view.accessors.size(); ++index) {
+                auto *accessor = view.accessors[index];
+                const auto accessorByteOffset = view.accessorByteOffsets[index];
+
+                copyAccessorData(*accessor, viewData + accessorByteOffset,
+                                 view.byteStride);
 
-        buffer = new GLTF::Buffer(bufferData, byteLength);
-        m_buffers.emplace_back(buffer);
-        buffer->name = bufferName;
-
-        int byteOffset = 0;
-        for (int byteStride : byteStrides) {
-            for (GLTF::BufferView *bufferView : bufferViews[byteStride]) {
-                std::memcpy(&bufferData[byteOffset], bufferView->buffer->data,
-                            bufferView->byteLength);
-                bufferView->byteOffset = byteOffset;
-                bufferView->buffer = buffer;
-                byteOffset += bufferView->byteLength;
+                accessor->byteOffset = static_cast<int>(accessorByteOffset);
+                accessor->bufferView = bufferView;
             }
+
+            if (glbWriter) {
+                glbWriter->addBinary(view.byteOffset, viewData,
+                                     view.byteLength);
+            }
+
+            if (hasher) {
+                const auto hashEnd = view.byteOffset + view.byteLength;
+                hasher->process(bufferData + hashedLength,
+                                hashEnd - hashedLength);
+                hashedLength = hashEnd;
+            }
+
+            continue;
         }
 
-#if 0
-        // Append compressed data to buffer.
-        for (GLTF::BufferView* compressedBufferView : compressedBufferViews) {
-            std::memcpy(bufferData + byteOffset, compressedBufferView->buffer->data, compressedBufferView->byteLength);
-            compressedBufferView->byteOffset = byteOffset;
-            compressedBufferView->buffer = buffer;
-            byteOffset += compressedBufferView->byteLength;
+        for (size_t index = 0; index < view.accessors.size(); ++index) {
+            auto *accessor = view.accessors[index];
+            const auto accessorByteOffset = view.accessorByteOffsets[index];
+
+            const auto byteOffset = view.byteOffset + accessorByteOffset;
+
+            const auto elementLength = elementByteLength(*accessor);
+            const auto accessorByteLength =
+                elementLength * static_cast<size_t>(accessor->count);
+
+            if (glbWriter) {
+                size_t sourceStride;
+                const auto *source = sourceData(*accessor, sourceStride);
+
+                if (sourceStride != elementLength) {
+                    // Only interleaved source data is copied.
+                    auto copy = new byte[accessorByteLength];
+                    m_data.emplace_back(copy);
+                    copyAccessorData(*accessor, copy);
+                    source = copy;
+                }
+
+                glbWriter->addBinary(byteOffset, source, accessorByteLength);
+            } else {
+                copyAccessorData(*accessor, bufferData + byteOffset);
+            }
+
+            if (hasher) {
+                // Hash the padding and the data while the latter is still in
+                // the cache.
+                const auto hashEnd = byteOffset + accessorByteLength;
+                hasher->process(bufferData + hashedLength,
+                                hashEnd - hashedLength);
+                hashedLength = hashEnd;
+            }
+
+            accessor->byteOffset = static_cast<int>(accessorByteOffset);
+            accessor->bufferView = bufferView;
         }
-#endif
+    }
+
+    if (glbWriter) {
+        glbWriter->reserveBinary(dataByteLength);
+    }
+
+    if (hasher) {
+        hasher->process(bufferData + hashedLength, byteLength - hashedLength);
+        m_bufferHashes[buffer] = hasher->hexDigest();
     }
 
     return buffer;
 }
 
+void AccessorPacker::packSeparately(
+    const std::vector<GLTF::Accessor *> &accessors) {
+    m_separateAccessors.insert(accessors.begin(), accessors.end());
+}
+
+void AccessorPacker::interleave(
+    const std::vector<GLTF::Accessor *> &accessors) {
+    const auto streamIndex = m_streamCount++;
+
+    for (GLTF::Accessor *accessor : accessors) {
+        const auto isVertexAttribute =
+            accessor->bufferView &&
+            accessor->bufferView->target == WebGL::ARRAY_BUFFER &&
+            accessor->count == accessors.front()->count;
+
+        // An accessor can only be in one vertex stream.
+        if (isVertexAttribute) {
+            m_streamIndices.emplace(accessor, streamIndex);
+        }
+    }
+}
+
 std::vector<GLTF::Buffer *> AccessorPacker::getPackedBuffers() const {
     std::vector<GLTF::Buffer *> buffers;
     for (auto &&buffer : m_buffers) {
@@ -172,3 +502,23 @@ std::vector<GLTF::Buffer *> AccessorPacker::getPackedBuffers() const {
     }
     return move(buffers);
 }
+
+bool AccessorPacker::commitMappedBuffer(GLTF::Buffer *buffer,
+                                        const std::string &path,
+                                        bool skipUnchanged) {
+    const auto it = m_mappedFiles.find(buffer);
+    if (it == m_mappedFiles.end())
+        return false;
+
+    it->second->commit(path, skipUnchanged);
+    m_mappedFiles.erase(it);
+
+    // The mapping is gone.
+    buffer->data = nullptr;
+    return true;
+}
+
+std::string AccessorPacker::bufferHash(GLTF::Buffer *buffer) const {
+    const auto it = m_bufferHashes.find(buffer);
+    return it == m_bufferHashes.end() ? std::string() : it->second;
+}
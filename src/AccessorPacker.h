@@ -1,21 +1,152 @@
 #pragma once
 
 #include "BasicTypes.h"
+#include "BufferHasher.h"
+#include "GlbWriter.h"
+#include "MappedOutputFile.h"
 
+/**
+ * Packs accessors into a single buffer, with a buffer view per target and
+ * byte stride.
+ *
+ * The layout of the whole buffer is computed first, then the data of each
+ * accessor is copied straight into its final place, with a single memcpy
+ * unless the source data is interleaved.
+ *
+ * Accessors with the same type, component type, count, target and data are
+ * packed only once, the duplicates share the buffer view and byte offset.
+ *
+ * Buffers larger than the maximum buffer size are split into several buffers,
+ * along accessor boundaries. The additional bytes are only reserved at the end
+ * of the first buffer.
+ *
+ * The vertex attributes of an interleaved vertex stream are packed into a
+ * single buffer view, with the elements of each vertex next to each other.
+ *
+ * Accessors that are packed separately never share a buffer view with the
+ * other accessors, only with each other.
+ */
 class AccessorPacker {
   public:
-    GLTF::Buffer *packAccessors(const std::vector<GLTF::Accessor *> &accessors,
-                                const std::string &bufferName,
-                                size_t additionalBufferSize = 0);
+    // Returns the packed buffers, usually one, none if there is no data.
+    // The additional bytes are reserved at the end of the first buffer.
+    // When a GLB writer is passed, the buffer has no data, the GLB writer
+    // writes the data of the accessors straight from their source memory.
+    std::vector<GLTF::Buffer *>
+    packAccessors(const std::vector<GLTF::Accessor *> &accessors,
+                  const std::string &bufferName,
+                  size_t additionalBufferSize = 0,
+                  GlbWriter *glbWriter = nullptr);
+
+    // Packs these vertex attribute accessors of a primitive into one
+    // interleaved buffer view, in this order.
+    void interleave(const std::vector<GLTF::Accessor *> &accessors);
+
+    // Packs these accessors into buffer views that no other accessors use.
+    // For accessors that the asset doesn't reference, since their buffer views
+    // must get an id before the asset is written.
+    void packSeparately(const std::vector<GLTF::Accessor *> &accessors);
+
+    // Limits the byte length of the following buffers. The glTF buffers
+    // store their byte length as an int, so buffers never exceed 2GB.
+    void limitBufferSize(size_t maxByteLength) {
+        m_maxBufferByteLength = std::min(maxBufferByteLength, maxByteLength);
+    }
 
     std::vector<GLTF::Buffer *> getPackedBuffers() const;
 
+    // Packs the following buffers straight into memory-mapped files in the
+    // folder, falling back to memory when a file can't be mapped.
+    void mapBuffersTo(const std::string &folder) { m_mappedFolder = folder; }
+
+    // If the buffer was packed into a memory-mapped file, flushes it and moves
+    // it to the path, unless skipping an unchanged file. Returns false when the
+    // buffer is in memory.
+    bool commitMappedBuffer(GLTF::Buffer *buffer, const std::string &path,
+                            bool skipUnchanged = false);
+
+    // Hashes the following buffers while packing them, instead of in a
+    // separate pass. Buffers written by a GLB writer are not hashed.
+    void hashBuffersWith(HashAlgorithm algorithm) {
+        m_isHashing = true;
+        m_hashAlgorithm = algorithm;
+    }
+
+    // The hash of the packed buffer as hex digits, empty if not hashed.
+    std::string bufferHash(GLTF::Buffer *buffer) const;
+
   private:
     std::vector<std::unique_ptr<byte[]>> m_data;
+    std::string m_mappedFolder;
+    std::map<GLTF::Buffer *, std::unique_ptr<MappedOutputFile>> m_mappedFiles;
+
+    bool m_isHashing = false;
+    HashAlgorithm m_hashAlgorithm = HashAlgorithm::SHA256;
+    std::map<GLTF::Buffer *, std::string> m_bufferHashes;
+
+    static constexpr size_t maxBufferByteLength =
+        static_cast<size_t>(std::numeric_limits<int>::max());
+
+    size_t m_maxBufferByteLength = maxBufferByteLength;
+
+    // The accessors to pack separately, see packSeparately.
+    std::set<GLTF::Accessor *> m_separateAccessors;
+
+    bool isPackedSeparately(GLTF::Accessor *accessor) const {
+        return m_separateAccessors.count(accessor) > 0;
+    }
+
+    // The interleaved vertex stream of each accessor, see interleave.
+    std::map<GLTF::Accessor *, size_t> m_streamIndices;
+    size_t m_streamCount = 0;
+
+    // Splits the accessors into groups that each fit in a buffer.
+    std::vector<std::vector<GLTF::Accessor *>>
+    splitAccessors(const std::vector<GLTF::Accessor *> &accessors,
+                   const std::string &bufferName, size_t additionalBufferSize,
+                   bool canSplit) const;
+
+    GLTF::Buffer *packBuffer(const std::vector<GLTF::Accessor *> &accessors,
+                             const std::string &bufferName,
+                             size_t additionalBufferSize,
+                             GlbWriter *glbWriter);
     std::vector<std::unique_ptr<GLTF::Buffer>> m_buffers;
     std::vector<std::unique_ptr<GLTF::BufferView>> m_views;
 
-    GLTF::BufferView *packAccessorsForTargetByteStride(
-        const std::vector<GLTF::Accessor *> &accessors,
-        GLTF::Constants::WebGL target);
+    // The place of a buffer view in the packed buffer, and of its accessors
+    // in the buffer view.
+    struct ViewLayout {
+        GLTF::Constants::WebGL target;
+        int byteStride;
+        bool isInterleaved = false;
+        size_t byteOffset = 0;
+        size_t byteLength = 0;
+        std::vector<GLTF::Accessor *> accessors;
+        std::vector<size_t> accessorByteOffsets;
+    };
+
+    // A duplicate accessor, and the first accessor with the same content.
+    typedef std::pair<GLTF::Accessor *, GLTF::Accessor *> Duplicate;
+
+    // Returns the accessors to pack, without the duplicates.
+    std::vector<GLTF::Accessor *>
+    removeDuplicates(const std::vector<GLTF::Accessor *> &accessors,
+                     std::vector<Duplicate> &duplicates) const;
+
+    static std::string contentHash(GLTF::Accessor &accessor);
+
+    static bool hasSameContent(GLTF::Accessor &a, GLTF::Accessor &b);
+
+    std::vector<ViewLayout>
+    computeLayout(const std::vector<GLTF::Accessor *> &accessors,
+                  size_t &byteLength) const;
+
+    // The data of the accessor, and the byte stride of its elements.
+    static const byte *sourceData(GLTF::Accessor &accessor,
+                                  size_t &byteStride);
+
+    // Copies the elements of the accessor, the destination stride defaults to
+    // the element byte length.
+    static void copyAccessorData(GLTF::Accessor &accessor, byte *destination,
+                                 size_t destinationStride = 0);
 };
@@ -0,0 +1,554 @@
+#include "externals.h"
+
+#include "AnimationBaseAsset.h"
+#include "IndentableStream.h"
+#include "filesystem.h"
+
+using JsonValue = rapidjson::Value;
+
+namespace {
+const uint32_t glbJsonChunkType = 0x4E4F534A;
+const uint32_t glbBinaryChunkType = 0x004E4942;
+
+// The suffixes of the extra nodes of complex transforms, see ExportableNode::load
+const char *const extraNodeSuffixes[] = {":SSC", ":PIV"};
+
+JsonValue *findMember(JsonValue &object, const char *key) {
+    if (!object.IsObject())
+        return nullptr;
+
+    const auto it = object.FindMember(key);
+    return it == object.MemberEnd() ? nullptr : &it->value;
+}
+
+JsonValue &arrayMember(JsonValue &object, const char *key, rapidjson::Document::AllocatorType &allocator) {
+    if (!object.HasMember(key)) {
+        object.AddMember(JsonValue(key, allocator), JsonValue(rapidjson::kArrayType), allocator);
+    }
+    return object[key];
+}
+
+size_t arraySize(JsonValue &object, const char *key) {
+    const auto *array = findMember(object, key);
+    return array && array->IsArray() ? array->Size() : 0;
+}
+
+template <typename Visit> void forEachElement(JsonValue &object, const char *key, Visit visit) {
+    auto *array = findMember(object, key);
+    if (array && array->IsArray()) {
+        for (auto element = array->Begin(); element != array->End(); ++element) {
+            visit(*element);
+        }
+    }
+}
+
+template <typename Visit> void forEachMemberValue(JsonValue &object, Visit visit) {
+    if (object.IsObject()) {
+        for (auto member = object.MemberBegin(); member != object.MemberEnd(); ++member) {
+            visit(member->value);
+        }
+    }
+}
+
+template <typename Visit> void forIndex(JsonValue &object, const char *key, Visit visit) {
+    auto *index = findMember(object, key);
+    if (index && index->IsInt()) {
+        visit(*index);
+    }
+}
+
+// Visits the accessor indices of the meshes and skins
+template <typename Visit> void forEachGeometryAccessor(JsonValue &document, Visit visit) {
+    forEachElement(document, "meshes", [&](JsonValue &mesh) {
+        forEachElement(mesh, "primitives", [&](JsonValue &primitive) {
+            forIndex(primitive, "indices", visit);
+
+            if (auto *attributes = findMember(primitive, "attributes")) {
+                forEachMemberValue(*attributes, visit);
+            }
+
+            forEachElement(primitive, "targets", [&](JsonValue &target) { forEachMemberValue(target, visit); });
+        });
+    });
+
+    forEachElement(document, "skins", [&](JsonValue &skin) { forIndex(skin, "inverseBindMatrices", visit); });
+}
+
+// Visits the buffer view indices of an accessor, including those of its sparse storage
+template <typename Visit> void forEachBufferView(JsonValue &accessor, Visit visit) {
+    forIndex(accessor, "bufferView", visit);
+
+    if (auto *sparse = findMember(accessor, "sparse")) {
+        if (auto *indices = findMember(*sparse, "indices")) {
+            forIndex(*indices, "bufferView", visit);
+        }
+        if (auto *values = findMember(*sparse, "values")) {
+            forIndex(*values, "bufferView", visit);
+        }
+    }
+}
+
+// Removes the elements of the array member that are not kept, and returns the new index of each old index, or -1
+std::vector<int> compact(JsonValue &object, const char *key, const std::vector<bool> &keep) {
+    std::vector<int> indexMap(keep.size(), -1);
+
+    auto *array = findMember(object, key);
+    if (!array || !array->IsArray())
+        return indexMap;
+
+    rapidjson::SizeType count = 0;
+
+    for (rapidjson::SizeType index = 0; index < array->Size(); ++index) {
+        if (keep[index]) {
+            indexMap[index] = static_cast<int>(count);
+            if (count != index) {
+                // Moves the element
+                (*array)[count] = (*array)[index];
+            }
+            ++count;
+        }
+    }
+
+    while (array->Size() > count) {
+        array->PopBack();
+    }
+
+    return indexMap;
+}
+
+void remap(JsonValue &index, const std::vector<int> &indexMap) { index.SetInt(indexMap.at(index.GetInt())); }
+
+// URIs with a scheme, including data URIs, are left alone
+bool isRelativeUri(const std::string &uri) { return uri.find(':') == std::string::npos; }
+
+// Copies the bytes of the buffer views of the buffer to a new buffer, and updates their byte offsets.
+// The bytes that no buffer view uses anymore, like those of dropped animations, are left out.
+std::vector<uint8_t> repackBuffer(JsonValue &document, const int bufferIndex, const std::vector<uint8_t> &data,
+                                  rapidjson::Document::AllocatorType &allocator) {
+    std::vector<uint8_t> packed;
+
+    forEachElement(document, "bufferViews", [&](JsonValue &bufferView) {
+        auto *buffer = findMember(bufferView, "buffer");
+        if (!buffer || !buffer->IsInt() || buffer->GetInt() != bufferIndex)
+            return;
+
+        auto *byteOffsetMember = findMember(bufferView, "byteOffset");
+        auto *byteLengthMember = findMember(bufferView, "byteLength");
+        const size_t byteOffset = byteOffsetMember ? byteOffsetMember->GetUint64() : 0;
+        const size_t byteLength = byteLengthMember ? byteLengthMember->GetUint64() : 0;
+
+        if (byteOffset > data.size() || byteLength > data.size() - byteOffset)
+            throw std::runtime_error("A buffer view exceeds the binary chunk of the animation base asset");
+
+        // Keep the buffer views aligned to 4 bytes, as their accessors require
+        const auto packedByteOffset = (packed.size() + 3) & ~size_t(3);
+        packed.resize(packedByteOffset);
+        packed.insert(packed.end(), data.begin() + byteOffset, data.begin() + byteOffset + byteLength);
+
+        bufferView.RemoveMember("byteOffset");
+        bufferView.AddMember("byteOffset", JsonValue(static_cast<uint64_t>(packedByteOffset)), allocator);
+    });
+
+    auto &buffer = document["buffers"][static_cast<rapidjson::SizeType>(bufferIndex)];
+    buffer.RemoveMember("byteLength");
+    buffer.AddMember("byteLength", JsonValue(static_cast<uint64_t>(packed.size())), allocator);
+
+    return packed;
+}
+
+// The path without symbolic links and dot segments, to compare it with other paths. The file doesn't need to exist.
+fs::path comparablePath(const fs::path &path) {
+    std::error_code errorCode;
+    const auto canonicalPath = fs::weakly_canonical(path, errorCode);
+    return errorCode ? fs::absolute(path).lexically_normal() : canonicalPath;
+}
+
+std::string nodeName(JsonValue &node) {
+    const auto *name = findMember(node, "name");
+    return name && name->IsString() ? name->GetString() : "";
+}
+} // namespace
+
+AnimationBaseAsset::AnimationBaseAsset(const std::string &path) : m_path(path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to open animation base asset " + path);
+
+    const std::vector<char> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    if (bytes.size() >= 12 && std::memcmp(bytes.data(), "glTF", 4) == 0) {
+        // A GLB has a 12 byte header, followed by the JSON chunk and an optional binary chunk, each with an 8 byte header
+        size_t offset = 12;
+
+        while (offset + 8 <= bytes.size()) {
+            uint32_t chunkHeader[2];
+            std::memcpy(chunkHeader, bytes.data() + offset, sizeof chunkHeader);
+            offset += sizeof chunkHeader;
+
+            const size_t chunkLength = chunkHeader[0];
+            if (chunkLength > bytes.size() - offset)
+                throw std::runtime_error("Truncated GLB chunk in animation base asset " + path);
+
+            const auto *chunk = bytes.data() + offset;
+
+            if (chunkHeader[1] == glbJsonChunkType) {
+                m_json.assign(chunk, chunkLength);
+            } else if (chunkHeader[1] == glbBinaryChunkType) {
+                m_binaryChunk.assign(chunk, chunk + chunkLength);
+            }
+
+            offset += chunkLength;
+        }
+    } else {
+        m_json.assign(bytes.begin(), bytes.end());
+    }
+
+    rapidjson::Document document;
+    if (document.Parse(m_json.c_str()).HasParseError() || !document.IsObject())
+        throw std::runtime_error("Failed to parse the JSON of animation base asset " + path);
+
+    forEachElement(document, "nodes", [this](JsonValue &node) {
+        auto name = nodeName(node);
+
+        for (const auto *suffix : extraNodeSuffixes) {
+            const auto suffixLength = strlen(suffix);
+            if (name.size() > suffixLength && name.compare(name.size() - suffixLength, suffixLength, suffix) == 0) {
+                name.resize(name.size() - suffixLength);
+            }
+        }
+
+        if (!name.empty()) {
+            m_mayaNodeNames.insert(name);
+        }
+    });
+
+    cout << prefix << "Loaded animation base asset '" << path << "' with " << arraySize(document, "nodes") << " nodes" << endl;
+}
+
+AnimationBaseAsset::~AnimationBaseAsset() = default;
+
+bool AnimationBaseAsset::isBasePath(const std::string &path) const { return comparablePath(path) == comparablePath(m_path); }
+
+AnimationBaseAsset::Merged AnimationBaseAsset::merge(const std::string &exportedJson, const size_t exportedBinaryLength,
+                                                     const std::string &outputFolder, const std::string &binaryUri, const bool glb) const {
+    rapidjson::Document base;
+    base.Parse(m_json.c_str());
+
+    auto &allocator = base.GetAllocator();
+
+    rapidjson::Document exported;
+    if (exported.Parse(exportedJson.c_str()).HasParseError())
+        throw std::runtime_error("Failed to parse the exported glTF JSON");
+
+    // Drop the accessors of the old animations, unless the geometry uses them too
+    std::vector<bool> keepAccessors(arraySize(base, "accessors"), true);
+
+    const auto dropAccessor = [&](JsonValue &index) { keepAccessors.at(index.GetInt()) = false; };
+    forEachElement(base, "animations", [&](JsonValue &animation) {
+        forEachElement(animation, "samplers", [&](JsonValue &sampler) {
+            forIndex(sampler, "input", dropAccessor);
+            forIndex(sampler, "output", dropAccessor);
+        });
+    });
+
+    forEachGeometryAccessor(base, [&](JsonValue &index) { keepAccessors.at(index.GetInt()) = true; });
+
+    base.RemoveMember("animations");
+
+    if (auto *extras = findMember(base, "extras")) {
+        extras->RemoveMember("clipChunks");
+    }
+
+    const auto accessorMap = compact(base, "accessors", keepAccessors);
+    forEachGeometryAccessor(base, [&](JsonValue &index) { remap(index, accessorMap); });
+
+    // Only keep the buffer views of the remaining accessors and images
+    std::vector<bool> keepBufferViews(arraySize(base, "bufferViews"), false);
+
+    const auto keepBufferView = [&](JsonValue &index) { keepBufferViews.at(index.GetInt()) = true; };
+    forEachElement(base, "accessors", [&](JsonValue &accessor) { forEachBufferView(accessor, keepBufferView); });
+    forEachElement(base, "images", [&](JsonValue &image) { forIndex(image, "bufferView", keepBufferView); });
+
+    const auto bufferViewMap = compact(base, "bufferViews", keepBufferViews);
+
+    const auto remapBufferView = [&](JsonValue &index) { remap(index, bufferViewMap); };
+    forEachElement(base, "accessors", [&](JsonValue &accessor) { forEachBufferView(accessor, remapBufferView); });
+    forEachElement(base, "images", [&](JsonValue &image) { forIndex(image, "bufferView", remapBufferView); });
+
+    // Only keep the buffers of the remaining buffer views
+    std::vector<bool> keepBuffers(arraySize(base, "buffers"), false);
+
+    forEachElement(base, "bufferViews", [&](JsonValue &bufferView) {
+        forIndex(bufferView, "buffer", [&](JsonValue &index) { keepBuffers.at(index.GetInt()) = true; });
+    });
+
+    const auto bufferMap = compact(base, "buffers", keepBuffers);
+
+    forEachElement(base, "bufferViews", [&](JsonValue &bufferView) {
+        forIndex(bufferView, "buffer", [&](JsonValue &index) { remap(index, bufferMap); });
+    });
+
+    // The external files of the base asset stay where they are
+    const auto baseFolder = fs::absolute(fs::path(m_path).parent_path());
+    const auto absoluteOutputFolder = fs::absolute(fs::path(outputFolder));
+
+    // The files written by this export must not replace the files the merged asset still references
+    std::set<fs::path> keptPaths;
+
+    const auto addKeptPath = [&](JsonValue &object) {
+        auto *uri = findMember(object, "uri");
+        if (uri && uri->IsString() && isRelativeUri(uri->GetString())) {
+            keptPaths.insert(comparablePath(baseFolder / uri->GetString()));
+        }
+    };
+
+    forEachElement(base, "buffers", addKeptPath);
+    forEachElement(base, "images", addKeptPath);
+
+    const auto checkOutputUri = [&](const std::string &uri) {
+        if (isRelativeUri(uri) && keptPaths.count(comparablePath(absoluteOutputFolder / uri))) {
+            throw std::runtime_error("The exported file '" + uri + "' would replace a file of the animation base asset " + m_path +
+                                     ", use another -sceneName or -outputFolder");
+        }
+    };
+
+    forEachElement(exported, "buffers", [&](JsonValue &buffer) {
+        auto *uri = findMember(buffer, "uri");
+        if (uri && uri->IsString()) {
+            checkOutputUri(uri->GetString());
+        }
+    });
+
+    if (!m_binaryChunk.empty() && !glb) {
+        checkOutputUri(binaryUri);
+    }
+
+    const auto rebaseUri = [&](JsonValue &object) {
+        auto *uri = findMember(object, "uri");
+        if (uri && uri->IsString() && isRelativeUri(uri->GetString())) {
+            const auto relativePath = fs::relative(baseFolder / uri->GetString(), absoluteOutputFolder).generic_string();
+            if (!relativePath.empty()) {
+                uri->SetString(relativePath.c_str(), allocator);
+            }
+        }
+    };
+
+    forEachElement(base, "buffers", rebaseUri);
+    forEachElement(base, "images", rebaseUri);
+
+    Merged merged;
+
+    // The buffer of the binary chunk of a GLB base asset has no URI
+    int binaryBufferIndex = -1;
+
+    if (!m_binaryChunk.empty()) {
+        int bufferIndex = 0;
+        forEachElement(base, "buffers", [&](JsonValue &buffer) {
+            if (!findMember(buffer, "uri")) {
+                binaryBufferIndex = bufferIndex;
+            }
+            ++bufferIndex;
+        });
+    }
+
+    auto &buffers = arrayMember(base, "buffers", allocator);
+
+    if (binaryBufferIndex >= 0) {
+        // Drop the bytes of the old animations, so these don't pile up when the output is used as the next base asset
+        merged.binaryChunk = repackBuffer(base, binaryBufferIndex, m_binaryChunk, allocator);
+
+        if (!glb) {
+            buffers[static_cast<rapidjson::SizeType>(binaryBufferIndex)].AddMember("uri", JsonValue(binaryUri.c_str(), allocator), allocator);
+        }
+    } else if (glb && exportedBinaryLength) {
+        // The binary chunk of a GLB must be the first buffer
+        buffers.PushBack(JsonValue(rapidjson::kObjectType), allocator);
+
+        for (auto index = buffers.Size() - 1; index > 0; --index) {
+            buffers[index] = buffers[index - 1];
+        }
+
+        buffers[0u].SetObject();
+
+        forEachElement(base, "bufferViews", [&](JsonValue &bufferView) {
+            forIndex(bufferView, "buffer", [&](JsonValue &index) { index.SetInt(index.GetInt() + 1); });
+        });
+
+        binaryBufferIndex = 0;
+    }
+
+    // Append the exported buffers, the binary chunk of the exported GLB is appended to the binary chunk of the base asset
+    std::vector<int> exportedBufferMap;
+    std::vector<size_t> exportedByteOffsets;
+
+    auto binaryLength = static_cast<size_t>(merged.binaryChunk.size());
+    merged.exportedByteOffset = (binaryLength + 3) & ~size_t(3);
+
+    forEachElement(exported, "buffers", [&](JsonValue &buffer) {
+        if (glb && !findMember(buffer, "uri") && binaryBufferIndex >= 0) {
+            binaryLength = merged.exportedByteOffset + exportedBinaryLength;
+
+            exportedBufferMap.push_back(binaryBufferIndex);
+            exportedByteOffsets.push_back(merged.exportedByteOffset);
+        } else {
+            exportedBufferMap.push_back(static_cast<int>(buffers.Size()));
+            exportedByteOffsets.push_back(0);
+            buffers.PushBack(JsonValue(buffer, allocator), allocator);
+        }
+    });
+
+    if (glb && binaryBufferIndex >= 0) {
+        auto &binaryBuffer = buffers[static_cast<rapidjson::SizeType>(binaryBufferIndex)];
+        binaryBuffer.RemoveMember("byteLength");
+        binaryBuffer.AddMember("byteLength", JsonValue(static_cast<uint64_t>(binaryLength)), allocator);
+    }
+
+    if (buffers.Empty()) {
+        base.RemoveMember("buffers");
+    }
+
+    // Append the exported buffer views and accessors
+    const auto bufferViewOffset = static_cast<int>(arraySize(base, "bufferViews"));
+
+    forEachElement(exported, "bufferViews", [&](JsonValue &bufferView) {
+        forIndex(bufferView, "buffer", [&](JsonValue &index) {
+            const auto exportedIndex = index.GetInt();
+            index.SetInt(exportedBufferMap.at(exportedIndex));
+
+            if (const auto byteOffset = exportedByteOffsets.at(exportedIndex)) {
+                auto *member = findMember(bufferView, "byteOffset");
+                const uint64_t exportedByteOffset = member ? member->GetUint64() : 0;
+                bufferView.RemoveMember("byteOffset");
+                bufferView.AddMember("byteOffset", JsonValue(exportedByteOffset + byteOffset), exported.GetAllocator());
+            }
+        });
+
+        arrayMember(base, "bufferViews", allocator).PushBack(JsonValue(bufferView, allocator), allocator);
+    });
+
+    const auto accessorOffset = static_cast<int>(arraySize(base, "accessors"));
+
+    forEachElement(exported, "accessors", [&](JsonValue &accessor) {
+        forEachBufferView(accessor, [&](JsonValue &index) { index.SetInt(index.GetInt() + bufferViewOffset); });
+        arrayMember(base, "accessors", allocator).PushBack(JsonValue(accessor, allocator), allocator);
+    });
+
+    // Map the exported nodes to the base nodes by name
+    std::map<std::string, int> baseNodeIndices;
+    std::set<std::string> ambiguousNames;
+
+    int baseNodeIndex = 0;
+    forEachElement(base, "nodes", [&](JsonValue &node) {
+        const auto name = nodeName(node);
+        if (!baseNodeIndices.emplace(name, baseNodeIndex++).second) {
+            ambiguousNames.insert(name);
+        }
+    });
+
+    std::vector<std::string> exportedNodeNames;
+    forEachElement(exported, "nodes", [&](JsonValue &node) { exportedNodeNames.push_back(nodeName(node)); });
+
+    // Replace the animations, dropping the channels of nodes that are not in the base asset
+    std::set<std::string> unmappedNames;
+    std::vector<int> animationMap;
+
+    JsonValue animations(rapidjson::kArrayType);
+
+    forEachElement(exported, "animations", [&](JsonValue &animation) {
+        JsonValue channels(rapidjson::kArrayType);
+        JsonValue samplers(rapidjson::kArrayType);
+
+        auto *exportedSamplers = findMember(animation, "samplers");
+
+        forEachElement(animation, "channels", [&](JsonValue &channel) {
+            auto *target = findMember(channel, "target");
+            auto *node = target ? findMember(*target, "node") : nullptr;
+            auto *sampler = findMember(channel, "sampler");
+
+            if (!node || !sampler || !exportedSamplers)
+                return;
+
+            const auto &name = exportedNodeNames.at(node->GetInt());
+            const auto baseNode = baseNodeIndices.find(name);
+
+            if (name.empty() || baseNode == baseNodeIndices.end() || ambiguousNames.count(name)) {
+                unmappedNames.insert(name.empty() ? "#" + std::to_string(node->GetInt()) : name);
+                return;
+            }
+
+            node->SetInt(baseNode->second);
+
+            JsonValue mergedSampler((*exportedSamplers)[sampler->GetInt()], allocator);
+            forIndex(mergedSampler, "input", [&](JsonValue &index) { index.SetInt(index.GetInt() + accessorOffset); });
+            forIndex(mergedSampler, "output", [&](JsonValue &index) { index.SetInt(index.GetInt() + accessorOffset); });
+
+            sampler->SetInt(static_cast<int>(samplers.Size()));
+            samplers.PushBack(mergedSampler, allocator);
+            channels.PushBack(JsonValue(channel, allocator), allocator);
+        });
+
+        if (channels.Empty()) {
+            animationMap.push_back(-1);
+            return;
+        }
+
+        animationMap.push_back(static_cast<int>(animations.Size()));
+
+        JsonValue mergedAnimation(animation, allocator);
+        mergedAnimation["channels"] = channels;
+        mergedAnimation["samplers"] = samplers;
+        animations.PushBack(mergedAnimation, allocator);
+    });
+
+    if (!unmappedNames.empty()) {
+        cerr << prefix << "WARNING: dropped the animation channels of " << unmappedNames.size()
+             << " nodes that have no unique name in the animation base asset:";
+        for (const auto &name : unmappedNames) {
+            cerr << " '" << name << "'";
+        }
+        cerr << endl;
+    }
+
+    if (!animations.Empty()) {
+        base.AddMember("animations", animations, allocator);
+    }
+
+    // Copy the manifest of the clip chunks, see ClipChunkManifest
+    auto *exportedExtras = findMember(exported, "extras");
+    auto *clipChunks = exportedExtras ? findMember(*exportedExtras, "clipChunks") : nullptr;
+
+    if (clipChunks && clipChunks->IsArray()) {
+        for (auto clip = clipChunks->Begin(); clip != clipChunks->End(); ++clip) {
+            std::vector<bool> keepChunks;
+
+            forEachElement(*clip, "chunks", [&](JsonValue &chunk) {
+                auto *animation = findMember(chunk, "animation");
+                const auto isKept = animation && animation->IsInt() && animationMap.at(animation->GetInt()) >= 0;
+
+                if (isKept) {
+                    remap(*animation, animationMap);
+                    forIndex(chunk, "buffer", [&](JsonValue &index) { remap(index, exportedBufferMap); });
+                    forEachElement(chunk, "buffers", [&](JsonValue &index) { remap(index, exportedBufferMap); });
+                }
+
+                keepChunks.push_back(isKept);
+            });
+
+            compact(*clip, "chunks", keepChunks);
+        }
+
+        if (!base.HasMember("extras")) {
+            base.AddMember("extras", JsonValue(rapidjson::kObjectType), allocator);
+        }
+
+        base["extras"].AddMember("clipChunks", JsonValue(*clipChunks, allocator), allocator);
+    }
+
+    rapidjson::StringBuffer jsonBuffer;
+    rapidjson::Writer<rapidjson::StringBuffer> jsonWriter(jsonBuffer);
+    base.Accept(jsonWriter);
+
+    merged.json = jsonBuffer.GetString();
+
+    return merged;
+}
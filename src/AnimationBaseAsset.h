@@ -0,0 +1,57 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * A previously exported glTF or GLB asset, whose nodes, meshes, skins and materials are reused by an animation-only export.
+ *
+ * The exported animations replace the animations of the base asset. Their channels are mapped to the nodes of the
+ * base asset by name, so the base asset must have been exported with the same naming arguments.
+ */
+class AnimationBaseAsset {
+  public:
+    explicit AnimationBaseAsset(const std::string &path);
+    ~AnimationBaseAsset();
+
+    /** The merged JSON, and where the binary data goes */
+    struct Merged {
+        std::string json;
+
+        /**
+         * The binary chunk of a GLB base asset, with only the bytes of the remaining buffer views.
+         * When writing a GLB it starts the binary chunk, otherwise it is written to the binary URI
+         */
+        std::vector<uint8_t> binaryChunk;
+
+        /** When writing a GLB, the offset of the exported binary chunk in the merged binary chunk */
+        size_t exportedByteOffset = 0;
+    };
+
+    /** Is the path the path of the base asset file? */
+    bool isBasePath(const std::string &path) const;
+
+    /** Does the base asset have a node for the Maya node with this glTF name? The :SSC and :PIV suffixes of extra nodes are ignored */
+    bool hasMayaNode(const std::string &name) const { return m_mayaNodeNames.count(name) > 0; }
+
+    /**
+     * Replaces the animations of the base asset by the animations of the exported asset.
+     * The accessors, buffer views and buffers that were only used by the old animations are dropped.
+     * Throws when an exported buffer would replace a buffer or image that the merged asset still references.
+     * @param exportedJson The exported asset, of which only the animations are used.
+     * @param exportedBinaryLength When writing a GLB, the length of the binary chunk of the exported asset.
+     * @param outputFolder The folder of the merged asset, the URIs of the base asset are made relative to this folder.
+     * @param binaryUri When not writing a GLB, the URI to write the binary chunk of a GLB base asset to.
+     */
+    Merged merge(const std::string &exportedJson, size_t exportedBinaryLength, const std::string &outputFolder,
+                 const std::string &binaryUri, bool glb) const;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(AnimationBaseAsset);
+
+    const std::string m_path;
+    std::string m_json;
+    std::vector<uint8_t> m_binaryChunk;
+
+    // The names of the base nodes, without the suffixes of the extra nodes.
+    std::set<std::string> m_mayaNodeNames;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "macros.h"
+
+// Per animation path, the maximum allowed deviation of the exported values from the sampled values
+struct ChannelTolerances {
+    double translation = 0;
+    double rotation = 0;
+    double scaling = 0;
+    double weights = 0;
+
+    ChannelTolerances(const double translation, const double rotation, const double scaling, const double weights)
+        : translation(translation), rotation(rotation), scaling(scaling), weights(weights) {}
+
+    static ChannelTolerances uniform(const double tolerance) { return {tolerance, tolerance, tolerance, tolerance}; }
+
+    DEFAULT_COPY_MOVE_ASSIGN_CTOR_DTOR(ChannelTolerances);
+};
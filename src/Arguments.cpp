@@ -74,12 +74,33 @@ const auto forceAnimationSampling = "fas";
 
 const auto detectStepAnimations = "dsa";
 
+const auto keyframeReduction = "kfr";
+const auto keyframeTolerance = "kft";
+const auto worldErrorTolerance = "wet";
+const auto sparseWeights = "spw";
+const auto clipBounds = "cbd";
+const auto vertexAnimationTextures = "vat";
+const auto clipChunkSeconds = "ccs";
+const auto streamSamples = "sms";
+const auto animationBaseAsset = "aba";
+
 const auto hashBufferURIs = "hbu";
+const auto hashAlgorithm = "hal";
 
 const auto dumpAccessorComponents = "dac";
 
 const auto niceBufferURIs = "nbu";
 
+const auto mappedOutput = "mpo";
+
+const auto compactJson = "cjs";
+
+const auto skipUnchangedFiles = "suf";
+
+const auto maxBufferSize = "mbs";
+
+const auto vertexLayout = "vxl";
+
 const auto convertUnsupportedImages = "cui";
 
 const auto reportSkewedInverseBindMatrices = "rsb";
@@ -166,6 +187,15 @@ SyntaxFactory::SyntaxFactory() {
     registerFlag(ss, flag::globalOpacityFactor, "globalOpacityFactor", kDouble);
     registerFlag(ss, flag::copyright, "copyright", kString);
     registerFlag(ss, flag::detectStepAnimations, "detectStepAnimations", kLong);
+    registerFlag(ss, flag::keyframeReduction, "keyframeReduction", kString);
+    registerFlag(ss, flag::keyframeTolerance, "keyframeTolerance", kDouble);
+    registerFlag(ss, flag::worldErrorTolerance, "worldErrorTolerance", kDouble);
+    registerFlag(ss, flag::sparseWeights, "sparseWeights", kNoArg);
+    registerFlag(ss, flag::clipBounds, "clipBounds", kNoArg);
+    registerFlag(ss, flag::vertexAnimationTextures, "vertexAnimationTextures", kString);
+    registerFlag(ss, flag::clipChunkSeconds, "clipChunkSeconds", kDouble);
+    registerFlag(ss, flag::streamSamples, "streamSamples", kNoArg);
+    registerFlag(ss, flag::animationBaseAsset, "animationBaseAsset", kString);
 
     registerFlag(ss, flag::animationClipFrameRate, "animationClipFrameRate", true, kDouble);
     registerFlag(ss, flag::animationClipName, "animationClipName", true, kString);
@@ -198,7 +228,13 @@ SyntaxFactory::SyntaxFactory() {
     registerFlag(ss, flag::forceAnimationSampling, "forceAnimationSampling", kNoArg);
 
     registerFlag(ss, flag::hashBufferURIs, "hashBufferURI", kNoArg);
+    registerFlag(ss, flag::hashAlgorithm, "hashAlgorithm", kString);
     registerFlag(ss, flag::niceBufferURIs, "niceBufferURIs", kNoArg);
+    registerFlag(ss, flag::mappedOutput, "mappedOutput", kNoArg);
+    registerFlag(ss, flag::compactJson, "compactJson", kNoArg);
+    registerFlag(ss, flag::skipUnchangedFiles, "skipUnchangedFiles", kNoArg);
+    registerFlag(ss, flag::maxBufferSize, "maxBufferSize", kDouble);
+    registerFlag(ss, flag::vertexLayout, "vertexLayout", kString);
 
     registerFlag(ss, flag::convertUnsupportedImages, "convertUnsupportedImages", kNoArg);
     registerFlag(ss, flag::reportSkewedInverseBindMatrices, "reportSkewedInverseBindMatrices", kNoArg);
@@ -502,7 +538,48 @@ Arguments::Arguments(const MArgList &args, const MSyntax &syntax) {
     forceAnimationChannels = adb.isFlagSet(flag::forceAnimationChannels);
     forceAnimationSampling = adb.isFlagSet(flag::forceAnimationSampling);
     hashBufferURIs = adb.isFlagSet(flag::hashBufferURIs);
+
+    MString hashAlgorithmArg;
+    if (adb.optional(flag::hashAlgorithm, hashAlgorithmArg)) {
+        const auto hashAlgorithmName = hashAlgorithmArg.toLowerCase();
+        if (hashAlgorithmName == "sha256") {
+            hashAlgorithm = HashAlgorithm::SHA256;
+        } else if (hashAlgorithmName == "xxh64") {
+            hashAlgorithm = HashAlgorithm::XXH64;
+        } else {
+            adb.throwInvalid(flag::hashAlgorithm, "Expected sha256 or xxh64");
+        }
+    }
     niceBufferURIs = adb.isFlagSet(flag::niceBufferURIs);
+    mappedOutput = adb.isFlagSet(flag::mappedOutput);
+    compactJson = adb.isFlagSet(flag::compactJson);
+
+    adb.optional(flag::maxBufferSize, maxBufferSize);
+    if (maxBufferSize < 0) {
+        adb.throwInvalid(flag::maxBufferSize, "Expected a positive size in megabytes");
+    }
+    if (maxBufferSize > 0 && glb) {
+        adb.throwInvalid(flag::maxBufferSize, "Cannot be combined with -glb, a glb file has only one binary buffer");
+    }
+
+    MString vertexLayoutArg;
+    if (adb.optional(flag::vertexLayout, vertexLayoutArg)) {
+        const auto vertexLayoutName = vertexLayoutArg.toLowerCase();
+        if (vertexLayoutName == "planar") {
+            vertexLayout = VertexBufferLayout::Planar;
+        } else if (vertexLayoutName == "interleaved") {
+            vertexLayout = VertexBufferLayout::Interleaved;
+        } else if (vertexLayoutName == "positionsplit") {
+            vertexLayout = VertexBufferLayout::PositionSplit;
+        } else {
+            adb.throwInvalid(flag::vertexLayout, "Expected planar, interleaved or positionSplit");
+        }
+    }
+
+    skipUnchangedFiles = adb.isFlagSet(flag::skipUnchangedFiles);
+    if (skipUnchangedFiles && cleanOutputFolder) {
+        adb.throwInvalid(flag::skipUnchangedFiles, "Cannot be combined with -cleanOutputFolder");
+    }
     convertUnsupportedImages = adb.isFlagSet(flag::convertUnsupportedImages);
     reportSkewedInverseBindMatrices = adb.isFlagSet(flag::reportSkewedInverseBindMatrices);
     clearOutputWindow = adb.isFlagSet(flag::clearOutputWindow);
@@ -543,6 +620,51 @@ Arguments::Arguments(const MArgList &args, const MSyntax &syntax) {
     debugNormalVectors = adb.isFlagSet(flag::debugNormalVectors);
 
     adb.optional(flag::detectStepAnimations, detectStepAnimations);
+
+    MString keyframeReductionArg;
+    if (adb.optional(flag::keyframeReduction, keyframeReductionArg)) {
+        const auto keyframeReductionName = keyframeReductionArg.toLowerCase();
+        if (keyframeReductionName == "none") {
+            keyframeReduction = KeyframeReduction::None;
+        } else if (keyframeReductionName == "linear") {
+            keyframeReduction = KeyframeReduction::Linear;
+        } else if (keyframeReductionName == "cubic") {
+            keyframeReduction = KeyframeReduction::Cubic;
+        } else {
+            adb.throwInvalid(flag::keyframeReduction, "Expected none, linear or cubic");
+        }
+    }
+
+    adb.optional(flag::keyframeTolerance, keyframeTolerance);
+    adb.optional(flag::worldErrorTolerance, worldErrorTolerance);
+    sparseWeights = adb.isFlagSet(flag::sparseWeights);
+    clipBounds = adb.isFlagSet(flag::clipBounds);
+    adb.optional(flag::clipChunkSeconds, clipChunkSeconds);
+    streamSamples = adb.isFlagSet(flag::streamSamples);
+
+    MString vertexAnimationFormatArg;
+    if (adb.optional(flag::vertexAnimationTextures, vertexAnimationFormatArg)) {
+        const auto vertexAnimationFormatName = vertexAnimationFormatArg.toLowerCase();
+        if (vertexAnimationFormatName == "none") {
+            vertexAnimationFormat = VertexAnimationFormat::None;
+        } else if (vertexAnimationFormatName == "float16") {
+            vertexAnimationFormat = VertexAnimationFormat::Float16;
+        } else if (vertexAnimationFormatName == "rgba8") {
+            vertexAnimationFormat = VertexAnimationFormat::RGBA8;
+        } else {
+            adb.throwInvalid(flag::vertexAnimationTextures, "Expected none, float16 or rgba8");
+        }
+    }
+    if (adb.optional(flag::animationBaseAsset, animationBaseAsset)) {
+        // The base asset is located by node names, and its external files must survive the export
+        if (disableNameAssignment) {
+            adb.throwInvalid(flag::animationBaseAsset, "Cannot be combined with -disableNameAssignment");
+        }
+        if (cleanOutputFolder) {
+            adb.throwInvalid(flag::animationBaseAsset, "Cannot be combined with -cleanOutputFolder");
+        }
+    }
+
     adb.optional(flag::debugVectorLength, debugVectorLength);
     adb.optional(flag::copyright, copyright);
 
@@ -702,6 +824,16 @@ std::string Arguments::assignName(GLTF::Object &glObj, const MDagPath &dagPath,
 }
 
 std::string Arguments::assignName(GLTF::Object &glObj, const MFnDependencyNode &node, const MString &suffix) const {
+    auto result = gltfName(node, suffix);
+
+    if (!disableNameAssignment) {
+        glObj.name = result;
+    }
+
+    return result;
+}
+
+std::string Arguments::gltfName(const MFnDependencyNode &node, const MString &suffix) const {
     MStatus status;
 
     auto name = node.name(&status);
@@ -716,13 +848,7 @@ std::string Arguments::assignName(GLTF::Object &glObj, const MFnDependencyNode &
 
     name += suffix;
 
-    std::string result(name.asChar());
-
-    if (!disableNameAssignment) {
-        glObj.name = result;
-    }
-
-    return result;
+    return name.asChar();
 }
 
 void Arguments::select(Selection &shapeSelection, Selection &cameraSelection, const MDagPath &dagPath, const bool includeDescendants,
@@ -798,6 +924,22 @@ void Arguments::select(Selection &shapeSelection, Selection &cameraSelection, co
 
 MTime AnimClipArg::duration() const { return MTime(frameCount() * (1.0 / framesPerSecond), MTime::kSeconds); }
 
+std::vector<AnimClipArg> AnimClipArg::chunks(const double chunkSeconds) const {
+    const auto startFrame = round(startTime.as(MTime::kSeconds) * framesPerSecond);
+    const auto endFrame = round(endTime.as(MTime::kSeconds) * framesPerSecond);
+    const auto chunkFrameCount = std::max(1.0, round(chunkSeconds * framesPerSecond));
+
+    std::vector<AnimClipArg> result;
+
+    for (auto chunkStartFrame = startFrame; chunkStartFrame < endFrame || result.empty(); chunkStartFrame += chunkFrameCount) {
+        const auto chunkEndFrame = std::min(endFrame, chunkStartFrame + chunkFrameCount);
+        result.emplace_back(name + "_" + std::to_string(result.size()), MTime(chunkStartFrame / framesPerSecond, MTime::kSeconds),
+                            MTime(chunkEndFrame / framesPerSecond, MTime::kSeconds), framesPerSecond, stepDetectSampleCount);
+    }
+
+    return result;
+}
+
 int AnimClipArg::frameCount() const {
     const auto exactStartFrame = startTime.as(MTime::kSeconds) * framesPerSecond;
     const auto exactEndFrame = endTime.as(MTime::kSeconds) * framesPerSecond;
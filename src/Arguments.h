@@ -1,6 +1,9 @@
 #pragma once
 
+#include "BufferHasher.h"
+#include "CurveFitter.h"
 #include "IndentableStream.h"
+#include "VertexAnimationTexture.h"
 #include "sceneTypes.h"
 
 class SyntaxFactory : MSyntax {
@@ -45,6 +48,10 @@ struct AnimClipArg {
 
     MTime duration() const;
     int frameCount() const;
+
+    // Splits the clip into consecutive clips of the given duration, named name_0, name_1, ...
+    // Each chunk ends at the first frame of the next one, so it can be played without the next one.
+    std::vector<AnimClipArg> chunks(double chunkSeconds) const;
 };
 
 struct MDagPathComparer {
@@ -93,6 +100,22 @@ class Arguments {
     /** Use nice buffer URIs instead of auto-generated ones */
     bool niceBufferURIs = false;
 
+    /** Pack the buffers straight into memory-mapped output files, instead of on the heap */
+    bool mappedOutput = false;
+
+    /** Write the glTF JSON without whitespace, instead of pretty formatted */
+    bool compactJson = false;
+
+    /** When positive, the maximum size of a buffer in megabytes, larger buffers are split into several buffers. Buffers are always
+     * smaller than 2GB. Not allowed with glb, which has only one binary buffer */
+    double maxBufferSize = 0;
+
+    /** How the vertex attributes of each primitive are laid out in the buffer views */
+    VertexBufferLayout vertexLayout = VertexBufferLayout::Planar;
+
+    /** Don't rewrite output files that already have the exported content, and replace the changed ones atomically */
+    bool skipUnchangedFiles = false;
+
     /** Create a default material for primitives that don't have shading in
      * Maya? */
     bool defaultMaterial = false;
@@ -209,10 +232,43 @@ class Arguments {
     /** Sample more frames to detect step functions in the animation? By default LINEAR interpolation is always used */
     int detectStepAnimations = 0;
 
+    /** How to reduce the sampled animation frames to keyframes. By default every frame is a key */
+    KeyframeReduction keyframeReduction = KeyframeReduction::None;
+
+    /** The maximum deviation of the reduced keyframes from the sampled animation frames */
+    double keyframeTolerance = 1e-4;
+
+    /** When positive, the maximum world-space displacement of the geometry that is allowed when dropping constant channels and reducing
+     * keyframes. This overrides the constant thresholds and keyframe tolerance for transform channels */
+    double worldErrorTolerance = 0;
+
+    /** When not empty, the path of a previously exported glTF or GLB file. Only the animations are exported, reusing the meshes,
+     * skins and materials of this asset, and mapping the animated nodes to its nodes by name */
+    MString animationBaseAsset;
+
+    /** Store the sampled animation values in a memory-mapped temporary file instead of on the heap, so long clips use bounded memory */
+    bool streamSamples = false;
+
+    /** When positive, split each clip into consecutive chunks of this duration, each with its own animation and buffer */
+    double clipChunkSeconds = 0;
+
+    /** Sample the deformed positions and normals of skinned and morphed meshes into vertex animation textures, in this format */
+    VertexAnimationFormat vertexAnimationFormat = VertexAnimationFormat::None;
+
+    /** Write the world-space bounds of each skinned or morphed mesh over each clip to the extras of the glTF animation */
+    bool clipBounds = false;
+
+    /** Write the blend shape weight animation outputs as sparse accessors, only storing the non-zero weights, when that is smaller.
+     * Weights held at a constant non-zero value are still stored for every frame */
+    bool sparseWeights = false;
+
     /** Use a hash of the buffer for its URI? Useful when exporting the same
      * mesh buffer per animation scene */
     bool hashBufferURIs = false;
 
+    /** The hash used for hashed buffer URIs */
+    HashAlgorithm hashAlgorithm = HashAlgorithm::SHA256;
+
     /**
      * The time where the 'initial values' of all nodes are to be found (aka
      * neutral base pose) By default the current time is used, unless animation
@@ -272,8 +328,13 @@ class Arguments {
     std::string assignName(GLTF::Object &glObj, const MDagPath &dagPath, const MString &suffix) const;
     std::string assignName(GLTF::Object &glObj, const MFnDependencyNode &node, const MString &suffix) const;
 
+    /** The name that assignName assigns */
+    std::string gltfName(const MFnDependencyNode &node, const MString &suffix) const;
+
     std::string makeName(const std::string &name) const { return disableNameAssignment ? "" : name; }
 
+    bool isAnimationOnly() const { return animationBaseAsset.length() > 0; }
+
     float getBakeScaleFactor() const { return bakeScalingFactor ? globalScaleFactor : 1; }
     float getRootScaleFactor() const { return bakeScalingFactor ? 1 : globalScaleFactor; }
 
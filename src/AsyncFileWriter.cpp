@@ -0,0 +1,119 @@
+#include "externals.h"
+
+#include "AsyncFileWriter.h"
+#include "IndentableStream.h"
+#include "outputFiles.h"
+
+AsyncFileWriter::AsyncFileWriter(const bool skipUnchangedFiles, const size_t maxThreadCount)
+    : m_skipUnchangedFiles{skipUnchangedFiles}, m_maxThreadCount{std::max<size_t>(1, maxThreadCount)} {}
+
+AsyncFileWriter::~AsyncFileWriter() { joinThreads(); }
+
+void AsyncFileWriter::write(const std::string &path, const void *data, const size_t byteLength) {
+    size_t pendingCount;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back({path, data, byteLength, nullptr, false});
+        pendingCount = m_jobs.size() - m_nextJobIndex;
+    }
+
+    m_jobAdded.notify_one();
+
+    // Start another worker while there are more pending writes than workers.
+    if (m_threads.size() < m_maxThreadCount && pendingCount > m_threads.size()) {
+        m_threads.emplace_back(&AsyncFileWriter::work, this);
+    }
+}
+
+void AsyncFileWriter::work() {
+    for (;;) {
+        Job *job;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAdded.wait(lock, [this] { return m_nextJobIndex < m_jobs.size() || m_isJoining; });
+
+            if (m_nextJobIndex == m_jobs.size())
+                return;
+
+            job = &m_jobs[m_nextJobIndex++];
+        }
+
+        try {
+            writeFile(*job);
+        } catch (...) {
+            job->error = std::current_exception();
+        }
+    }
+}
+
+void AsyncFileWriter::writeFile(Job &job) const {
+    if (m_skipUnchangedFiles) {
+        const auto data = static_cast<const uint8_t *>(job.data);
+        job.isUnchanged = !writeChangedFile(job.path, {gsl::make_span(data, data + job.byteLength)});
+        return;
+    }
+
+    std::ofstream file(job.path, std::ios::out | std::ios::binary);
+
+    if (!file.is_open())
+        throw std::runtime_error("Couldn't write to '" + job.path + "'");
+
+    file.write(static_cast<const char *>(job.data), job.byteLength);
+    file.close();
+
+    if (!file)
+        throw std::runtime_error("Failed to write '" + job.path + "'");
+}
+
+void AsyncFileWriter::joinThreads() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isJoining = true;
+    }
+
+    m_jobAdded.notify_all();
+
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+
+    m_threads.clear();
+    m_isJoining = false;
+}
+
+void AsyncFileWriter::join() {
+    joinThreads();
+
+    std::exception_ptr firstError;
+    size_t unchangedCount = 0;
+
+    for (auto &job : m_jobs) {
+        unchangedCount += job.isUnchanged;
+
+        if (!job.error)
+            continue;
+
+        try {
+            std::rethrow_exception(job.error);
+        } catch (const std::exception &e) {
+            cerr << prefix << "ERROR: " << e.what() << endl;
+        }
+
+        if (!firstError) {
+            firstError = job.error;
+        }
+    }
+
+    if (unchangedCount) {
+        cout << prefix << "Skipped " << unchangedCount << " unchanged files" << endl;
+    }
+
+    m_jobs.clear();
+    m_nextJobIndex = 0;
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
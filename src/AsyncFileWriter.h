@@ -0,0 +1,51 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * Writes files concurrently on a small pool of worker threads, so many small files on a slow (network) drive don't serialize the export.
+ *
+ * The workers are started on demand. Failures are reported by join, in the order the writes were issued.
+ * When skipping unchanged files, files that already have the content are not touched, others are replaced atomically.
+ */
+class AsyncFileWriter {
+  public:
+    explicit AsyncFileWriter(bool skipUnchangedFiles = false, size_t maxThreadCount = 8);
+
+    /** Waits for the pending writes, without reporting failures */
+    ~AsyncFileWriter();
+
+    /** Writes the bytes to a new file at the path. The bytes must stay valid until join returns */
+    void write(const std::string &path, const void *data, size_t byteLength);
+
+    /** Waits until all files are written. Reports each failed write in issue order, and throws the first failure */
+    void join();
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(AsyncFileWriter);
+
+    struct Job {
+        std::string path;
+        const void *data;
+        size_t byteLength;
+        std::exception_ptr error;
+        bool isUnchanged;
+    };
+
+    const bool m_skipUnchangedFiles;
+    const size_t m_maxThreadCount;
+
+    // A deque, so the workers can keep references to their jobs while new jobs are added
+    std::deque<Job> m_jobs;
+    size_t m_nextJobIndex = 0;
+    bool m_isJoining = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobAdded;
+    std::vector<std::thread> m_threads;
+
+    void work();
+    void joinThreads();
+
+    void writeFile(Job &job) const;
+};
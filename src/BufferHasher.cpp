@@ -0,0 +1,148 @@
+#include "externals.h"
+
+#include "BufferHasher.h"
+#include "picosha2.h"
+
+namespace {
+class Sha256Hasher : public BufferHasher {
+  public:
+    void process(const uint8_t *data, const size_t byteLength) override { m_hasher.process(data, data + byteLength); }
+
+    std::string hexDigest() override {
+        m_hasher.finish();
+        std::string hex;
+        picosha2::get_hash_hex_string(m_hasher, hex);
+        return hex;
+    }
+
+  private:
+    picosha2::hash256_one_by_one m_hasher;
+};
+
+/** XXH64, see https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md */
+class Xxh64Hasher : public BufferHasher {
+  public:
+    Xxh64Hasher() : m_accumulators{prime1 + prime2, prime2, 0, 0 - prime1} {}
+
+    void process(const uint8_t *data, size_t byteLength) override {
+        m_totalLength += byteLength;
+
+        // Complete the pending stripe first
+        if (m_pendingLength) {
+            const auto length = std::min(byteLength, stripeLength - m_pendingLength);
+            std::memcpy(m_pending + m_pendingLength, data, length);
+            m_pendingLength += length;
+            data += length;
+            byteLength -= length;
+
+            if (m_pendingLength < stripeLength)
+                return;
+
+            processStripe(m_pending);
+            m_pendingLength = 0;
+        }
+
+        for (; byteLength >= stripeLength; data += stripeLength, byteLength -= stripeLength) {
+            processStripe(data);
+        }
+
+        std::memcpy(m_pending, data, byteLength);
+        m_pendingLength = byteLength;
+    }
+
+    std::string hexDigest() override {
+        uint64_t hash;
+
+        if (m_totalLength >= stripeLength) {
+            const auto &acc = m_accumulators;
+            hash = rotateLeft(acc[0], 1) + rotateLeft(acc[1], 7) + rotateLeft(acc[2], 12) + rotateLeft(acc[3], 18);
+
+            for (const auto accumulator : acc) {
+                hash = (hash ^ round(0, accumulator)) * prime1 + prime4;
+            }
+        } else {
+            hash = prime5;
+        }
+
+        hash += m_totalLength;
+
+        const uint8_t *data = m_pending;
+        auto length = m_pendingLength;
+
+        for (; length >= 8; data += 8, length -= 8) {
+            hash = rotateLeft(hash ^ round(0, read64(data)), 27) * prime1 + prime4;
+        }
+
+        if (length >= 4) {
+            hash = rotateLeft(hash ^ (read32(data) * prime1), 23) * prime2 + prime3;
+            data += 4;
+            length -= 4;
+        }
+
+        for (; length > 0; ++data, --length) {
+            hash = rotateLeft(hash ^ (*data * prime5), 11) * prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= prime2;
+        hash ^= hash >> 29;
+        hash *= prime3;
+        hash ^= hash >> 32;
+
+        std::ostringstream ss;
+        ss << std::hex << std::setfill('0') << std::setw(16) << hash;
+        return ss.str();
+    }
+
+  private:
+    static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+    static constexpr size_t stripeLength = 32;
+
+    uint64_t m_accumulators[4];
+    uint64_t m_totalLength = 0;
+
+    uint8_t m_pending[stripeLength];
+    size_t m_pendingLength = 0;
+
+    static uint64_t rotateLeft(const uint64_t value, const int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+    static uint64_t round(const uint64_t accumulator, const uint64_t lane) {
+        return rotateLeft(accumulator + lane * prime2, 31) * prime1;
+    }
+
+    // Little-endian, like all platforms Maya runs on
+    static uint64_t read64(const uint8_t *data) {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof value);
+        return value;
+    }
+
+    static uint64_t read32(const uint8_t *data) {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof value);
+        return value;
+    }
+
+    void processStripe(const uint8_t *data) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            m_accumulators[lane] = round(m_accumulators[lane], read64(data + lane * 8));
+        }
+    }
+};
+} // namespace
+
+std::unique_ptr<BufferHasher> BufferHasher::create(const HashAlgorithm algorithm) {
+    switch (algorithm) {
+    case HashAlgorithm::SHA256:
+        return std::make_unique<Sha256Hasher>();
+    case HashAlgorithm::XXH64:
+        return std::make_unique<Xxh64Hasher>();
+    }
+
+    throw std::runtime_error("Unknown hash algorithm");
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "macros.h"
+
+/** The hash used for hashed buffer URIs */
+enum class HashAlgorithm {
+    /** SHA-256, 64 hex digits */
+    SHA256,
+    /** The non-cryptographic 64-bit xxHash, 16 hex digits, many times faster */
+    XXH64
+};
+
+/**
+ * Hashes the bytes of a buffer incrementally, while the buffer is packed.
+ */
+class BufferHasher {
+  public:
+    virtual ~BufferHasher() = default;
+
+    static std::unique_ptr<BufferHasher> create(HashAlgorithm algorithm);
+
+    /** Hashes the next bytes */
+    virtual void process(const uint8_t *data, size_t byteLength) = 0;
+
+    /** The hash of all processed bytes, as lower-case hex digits */
+    virtual std::string hexDigest() = 0;
+};
@@ -0,0 +1,80 @@
+#include "externals.h"
+
+#include "Arguments.h"
+#include "ClipBounds.h"
+#include "ExportableNode.h"
+#include "MeshBounds.h"
+#include "NodeAnimation.h"
+
+ClipBounds::ClipBounds(const Arguments &args, const ExportableScene &scene, gsl::span<NodeAnimation *const> nodeAnimations)
+    : m_args(args) {
+    for (auto &pair : scene.table()) {
+        auto &node = pair.second;
+        auto *mesh = node->mesh();
+        if (mesh && mesh->bounds()) {
+            const auto blendShapeCount = mesh->blendShapeCount();
+
+            const auto animation = std::find_if(nodeAnimations.begin(), nodeAnimations.end(), [&node](const NodeAnimation *a) {
+                return &a->node == node.get();
+            });
+
+            if (blendShapeCount > 0 && animation != nodeAnimations.end()) {
+                m_entries.push_back({node.get(), *animation, {}, MBoundingBox(), true});
+            } else {
+                m_entries.push_back({node.get(), nullptr, std::vector<float>(blendShapeCount), MBoundingBox(), true});
+            }
+        }
+    }
+}
+
+ClipBounds::~ClipBounds() = default;
+
+void ClipBounds::sample(NodeTransformCache &transformCache) {
+    for (auto &entry : m_entries) {
+        auto *mesh = entry.node->mesh();
+
+        gsl::span<const float> weights;
+
+        if (entry.animation) {
+            // Reuse the weights the node animation just read.
+            weights = entry.animation->lastFrameWeights();
+        } else if (!entry.weights.empty()) {
+            mesh->readWeights(gsl::make_span(entry.weights));
+            weights = span(entry.weights);
+        }
+
+        mesh->bounds()->expand(transformCache, *entry.node, weights, m_args, entry.bounds, entry.isEmpty);
+    }
+}
+
+void ClipBounds::writeJSON(void *writer, GLTF::Options *options) {
+    auto *jsonWriter = static_cast<rapidjson::Writer<rapidjson::StringBuffer> *>(writer);
+
+    // The bounds are in glTF units of the meshes, the root node applies the remaining scale factor.
+    const auto rootScaleFactor = m_args.getRootScaleFactor();
+
+    const auto writePoint = [&](const char *key, const MPoint &point) {
+        jsonWriter->Key(key);
+        jsonWriter->StartArray();
+        jsonWriter->Double(static_cast<float>(point.x * rootScaleFactor));
+        jsonWriter->Double(static_cast<float>(point.y * rootScaleFactor));
+        jsonWriter->Double(static_cast<float>(point.z * rootScaleFactor));
+        jsonWriter->EndArray();
+    };
+
+    jsonWriter->StartArray();
+
+    for (auto &entry : m_entries) {
+        if (entry.isEmpty)
+            continue;
+
+        jsonWriter->StartObject();
+        jsonWriter->Key("mesh");
+        jsonWriter->Int(entry.node->mesh()->glMesh.id);
+        writePoint("min", entry.bounds.min());
+        writePoint("max", entry.bounds.max());
+        jsonWriter->EndObject();
+    }
+
+    jsonWriter->EndArray();
+}
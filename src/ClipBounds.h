@@ -0,0 +1,44 @@
+#pragma once
+
+#include "macros.h"
+
+class Arguments;
+class ExportableScene;
+class ExportableNode;
+class NodeAnimation;
+class NodeTransformCache;
+
+/**
+ * Accumulates the world-space bounds of each skinned or morphed mesh over the frames of a clip.
+ *
+ * Written as an array of {mesh, min, max} objects, where mesh is the index of the glTF mesh,
+ * and min and max are the corners of its axis-aligned bounding box in the space of the glTF scene.
+ */
+class ClipBounds : public GLTF::Object {
+  public:
+    // The weights of morphed meshes are taken from the node animations that sample them.
+    ClipBounds(const Arguments &args, const ExportableScene &scene, gsl::span<NodeAnimation *const> nodeAnimations);
+    ~ClipBounds() override;
+
+    bool isEmpty() const { return m_entries.empty(); }
+
+    // Expands the bounds of all meshes at the current time, after the node animations sampled the first sample of the frame.
+    void sample(NodeTransformCache &transformCache);
+
+    void writeJSON(void *writer, GLTF::Options *options) override;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(ClipBounds);
+
+    struct Entry {
+        const ExportableNode *node;
+        const NodeAnimation *animation;
+        // The weights of a morphed mesh without animation, read at each sample.
+        std::vector<float> weights;
+        MBoundingBox bounds;
+        bool isEmpty;
+    };
+
+    const Arguments &m_args;
+    std::vector<Entry> m_entries;
+};
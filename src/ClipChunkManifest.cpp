@@ -0,0 +1,64 @@
+#include "externals.h"
+
+#include "ClipChunkManifest.h"
+
+void ClipChunkManifest::add(const std::string &clipName, GLTF::Animation *animation, const double startSeconds,
+                            const double durationSeconds) {
+    m_chunks.push_back({clipName, animation, {}, startSeconds, durationSeconds});
+}
+
+void ClipChunkManifest::setBuffers(const GLTF::Animation *animation, const std::vector<GLTF::Buffer *> &buffers) {
+    for (auto &chunk : m_chunks) {
+        if (chunk.animation == animation) {
+            chunk.buffers = buffers;
+        }
+    }
+}
+
+void ClipChunkManifest::writeJSON(void *writer, GLTF::Options *options) {
+    auto *jsonWriter = static_cast<rapidjson::Writer<rapidjson::StringBuffer> *>(writer);
+
+    jsonWriter->StartArray();
+
+    for (size_t index = 0; index < m_chunks.size(); ++index) {
+        const auto &clipName = m_chunks[index].clipName;
+
+        if (index == 0 || m_chunks[index - 1].clipName != clipName) {
+            jsonWriter->StartObject();
+            jsonWriter->Key("name");
+            jsonWriter->String(clipName.c_str());
+            jsonWriter->Key("chunks");
+            jsonWriter->StartArray();
+        }
+
+        const auto &chunk = m_chunks[index];
+
+        jsonWriter->StartObject();
+        jsonWriter->Key("animation");
+        jsonWriter->Int(chunk.animation->id);
+        if (!chunk.buffers.empty()) {
+            jsonWriter->Key("buffer");
+            jsonWriter->Int(chunk.buffers.front()->id);
+        }
+        if (chunk.buffers.size() > 1) {
+            jsonWriter->Key("buffers");
+            jsonWriter->StartArray();
+            for (auto *buffer : chunk.buffers) {
+                jsonWriter->Int(buffer->id);
+            }
+            jsonWriter->EndArray();
+        }
+        jsonWriter->Key("start");
+        jsonWriter->Double(chunk.startSeconds);
+        jsonWriter->Key("duration");
+        jsonWriter->Double(chunk.durationSeconds);
+        jsonWriter->EndObject();
+
+        if (index + 1 == m_chunks.size() || m_chunks[index + 1].clipName != clipName) {
+            jsonWriter->EndArray();
+            jsonWriter->EndObject();
+        }
+    }
+
+    jsonWriter->EndArray();
+}
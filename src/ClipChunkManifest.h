@@ -0,0 +1,41 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * Describes how long clips were split into consecutive chunks, so a player can
+ * start playing a clip after loading its first chunk.
+ *
+ * Written as an array of {name, chunks} objects, one per clip, where each chunk is
+ * a {animation, buffer, start, duration} object. The buffer is omitted when the chunks
+ * share their buffer. When the chunk was split over several buffers, these are listed
+ * in an extra buffers array, starting with the buffer.
+ */
+class ClipChunkManifest : public GLTF::Object {
+  public:
+    ClipChunkManifest() = default;
+    ~ClipChunkManifest() override = default;
+
+    bool isEmpty() const { return m_chunks.empty(); }
+
+    /** Adds the next chunk of a clip, chunks of the same clip must be added consecutively */
+    void add(const std::string &clipName, GLTF::Animation *animation, double startSeconds, double durationSeconds);
+
+    /** Sets the buffers that store the accessors of the chunk */
+    void setBuffers(const GLTF::Animation *animation, const std::vector<GLTF::Buffer *> &buffers);
+
+    void writeJSON(void *writer, GLTF::Options *options) override;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(ClipChunkManifest);
+
+    struct Chunk {
+        std::string clipName;
+        GLTF::Animation *animation;
+        std::vector<GLTF::Buffer *> buffers;
+        double startSeconds;
+        double durationSeconds;
+    };
+
+    std::vector<Chunk> m_chunks;
+};
@@ -0,0 +1,214 @@
+#include "externals.h"
+
+#include "Arguments.h"
+#include "ClipVertexAnimation.h"
+#include "ExportableNode.h"
+#include "MayaException.h"
+#include "accessors.h"
+
+ClipVertexAnimation::ClipVertexAnimation(const Arguments &args, const ExportableScene &scene, const size_t frameCount)
+    : m_args(args), m_format(args.vertexAnimationFormat) {
+    MStatus status;
+
+    for (auto &pair : scene.table()) {
+        auto *mesh = pair.second->mesh();
+        if (!mesh || mesh->vertexAnimationSources().empty())
+            continue;
+
+        Shape shape;
+        shape.dagPath = mesh->shapeDagPath();
+
+        // Flip the normals like the exported mesh does
+        MFnMesh fnMesh(shape.dagPath, &status);
+        THROW_ON_FAILURE(status);
+
+        bool shouldFlipNormals = false;
+        auto oppositePlug = fnMesh.findPlug("opposite", true, &status);
+        THROW_ON_FAILURE(status);
+        THROW_ON_FAILURE(oppositePlug.getValue(shouldFlipNormals));
+        shape.normalSign = shouldFlipNormals ? -1.0f : 1.0f;
+
+        auto &sources = mesh->vertexAnimationSources();
+
+        for (size_t sourceIndex = 0; sourceIndex < sources.size(); ++sourceIndex) {
+            const auto vertexCount = sources[sourceIndex].pointIndices.size();
+
+            Primitive primitive;
+            primitive.mesh = mesh;
+            primitive.sourceIndex = sourceIndex;
+            primitive.positions.texture = std::make_unique<VertexAnimationTexture>(vertexCount, frameCount, false);
+            primitive.normals.texture = std::make_unique<VertexAnimationTexture>(vertexCount, frameCount, true);
+
+            shape.primitiveIndices.push_back(m_primitives.size());
+            m_primitives.emplace_back(std::move(primitive));
+        }
+
+        m_shapes.emplace_back(std::move(shape));
+    }
+}
+
+ClipVertexAnimation::~ClipVertexAnimation() = default;
+
+void ClipVertexAnimation::sampleAt(const size_t frameIndex) {
+    MStatus status;
+
+    const auto positionScale = m_args.getBakeScaleFactor();
+
+    for (auto &shape : m_shapes) {
+        MFnMesh fnMesh(shape.dagPath, &status);
+        THROW_ON_FAILURE(status);
+
+        // Same spaces as the exported mesh, see MeshVertices
+        THROW_ON_FAILURE(fnMesh.getPoints(m_points, MSpace::kTransform));
+        THROW_ON_FAILURE(fnMesh.getNormals(m_normals, MSpace::kWorld));
+
+        const auto pointCount = static_cast<Index>(m_points.length());
+        const auto normalCount = static_cast<Index>(m_normals.length());
+
+        for (auto primitiveIndex : shape.primitiveIndices) {
+            auto &primitive = m_primitives[primitiveIndex];
+            auto &source = primitive.mesh->vertexAnimationSources()[primitive.sourceIndex];
+
+            auto positions = primitive.positions.texture->frameVectors(frameIndex);
+            auto normals = primitive.normals.texture->frameVectors(frameIndex);
+
+            const auto vertexCount = source.pointIndices.size();
+
+            for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+                auto *position = &positions[vertexIndex * 3];
+                auto *normal = &normals[vertexIndex * 3];
+
+                const auto pointIndex = source.pointIndices[vertexIndex];
+                if (pointIndex >= 0 && pointIndex < pointCount) {
+                    const auto &p = m_points[pointIndex];
+                    position[0] = static_cast<float>(p.x * positionScale);
+                    position[1] = static_cast<float>(p.y * positionScale);
+                    position[2] = static_cast<float>(p.z * positionScale);
+                }
+
+                const auto normalIndex = source.normalIndices[vertexIndex];
+                if (normalIndex >= 0 && normalIndex < normalCount) {
+                    const auto &n = m_normals[normalIndex];
+                    normal[0] = shape.normalSign * n.x;
+                    normal[1] = shape.normalSign * n.y;
+                    normal[2] = shape.normalSign * n.z;
+                }
+            }
+        }
+    }
+}
+
+void ClipVertexAnimation::finish(const std::string &name) {
+    std::vector<Texture *> textures;
+    textures.reserve(m_primitives.size() * 2);
+
+    for (auto &primitive : m_primitives) {
+        textures.push_back(&primitive.positions);
+        textures.push_back(&primitive.normals);
+    }
+
+    // Quantizing is independent per texture, so spread the textures over worker threads.
+    std::atomic<size_t> nextTextureIndex{0};
+
+    const auto worker = [&]() {
+        for (auto index = nextTextureIndex++; index < textures.size(); index = nextTextureIndex++) {
+            textures[index]->texture->pack(m_format);
+        }
+    };
+
+    const auto threadCount = std::min<size_t>(textures.size(), std::max(1U, std::thread::hardware_concurrency()));
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // Use 32-bit words, so the texels of all primitives can share a buffer view.
+    for (size_t primitiveIndex = 0; primitiveIndex < m_primitives.size(); ++primitiveIndex) {
+        auto &primitive = m_primitives[primitiveIndex];
+        const auto prefix = name.empty() ? name : name + "/vat/" + std::to_string(primitiveIndex);
+
+        for (auto *texture : {&primitive.positions, &primitive.normals}) {
+            const auto suffix = texture->texture->isDirection ? "/normals" : "/positions";
+            texture->accessor = contiguousAccessor(prefix.empty() ? prefix : prefix + suffix, GLTF::Accessor::Type::SCALAR,
+                                                   GLTF::Constants::WebGL::UNSIGNED_INT, static_cast<GLTF::Constants::WebGL>(-1),
+                                                   texture->texture->texels(), 1);
+        }
+    }
+}
+
+void ClipVertexAnimation::getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const {
+    for (auto &primitive : m_primitives) {
+        for (auto *texture : {&primitive.positions, &primitive.normals}) {
+            if (texture->accessor) {
+                accessors.emplace_back(texture->accessor.get());
+            }
+        }
+    }
+}
+
+void ClipVertexAnimation::writeJSON(void *writer, GLTF::Options *options) {
+    auto *jsonWriter = static_cast<rapidjson::Writer<rapidjson::StringBuffer> *>(writer);
+
+    const auto writeVector = [&](const char *key, const std::array<float, 3> &v) {
+        jsonWriter->Key(key);
+        jsonWriter->StartArray();
+        for (auto c : v) {
+            jsonWriter->Double(c);
+        }
+        jsonWriter->EndArray();
+    };
+
+    const auto writeTexels = [&](const char *key, const Texture &texture) {
+        auto *accessor = texture.accessor.get();
+        if (!accessor || !accessor->bufferView || accessor->bufferView->id < 0)
+            throw std::runtime_error(std::string("The vertex animation ") + key + " have no buffer view id");
+
+        jsonWriter->Key(key);
+        jsonWriter->StartObject();
+        jsonWriter->Key("bufferView");
+        jsonWriter->Int(accessor->bufferView->id);
+        jsonWriter->Key("byteOffset");
+        jsonWriter->Int(accessor->byteOffset);
+        jsonWriter->Key("byteLength");
+        jsonWriter->Int(accessor->count * static_cast<int>(sizeof(uint32_t)));
+        writeVector("min", texture.texture->min());
+        writeVector("max", texture.texture->max());
+        jsonWriter->EndObject();
+    };
+
+    jsonWriter->StartArray();
+
+    for (auto &primitive : m_primitives) {
+        const auto &texture = *primitive.positions.texture;
+
+        jsonWriter->StartObject();
+        jsonWriter->Key("mesh");
+        jsonWriter->Int(primitive.mesh->glMesh.id);
+        jsonWriter->Key("primitive");
+        jsonWriter->Int(static_cast<int>(primitive.mesh->vertexAnimationSources()[primitive.sourceIndex].primitiveIndex));
+        jsonWriter->Key("format");
+        jsonWriter->String(m_format == VertexAnimationFormat::Float16 ? "float16" : "rgba8");
+        jsonWriter->Key("width");
+        jsonWriter->Int(static_cast<int>(texture.width()));
+        jsonWriter->Key("height");
+        jsonWriter->Int(static_cast<int>(texture.height()));
+        jsonWriter->Key("rowsPerFrame");
+        jsonWriter->Int(static_cast<int>(texture.rowsPerFrame()));
+        jsonWriter->Key("frameCount");
+        jsonWriter->Int(static_cast<int>(texture.frameCount));
+        writeTexels("positions", primitive.positions);
+        writeTexels("normals", primitive.normals);
+        jsonWriter->EndObject();
+    }
+
+    jsonWriter->EndArray();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "VertexAnimationTexture.h"
+#include "macros.h"
+
+class Arguments;
+class ExportableScene;
+class ExportableMesh;
+
+/**
+ * Samples the deformed positions and normals of each skinned or morphed mesh over the frames of a clip,
+ * into vertex animation textures, see VertexAnimationTexture.
+ *
+ * The vertices are in the same order as the vertices of the primitives, so the textures can replace
+ * skinning and morphing at runtime.
+ *
+ * The texels are stored in the buffer of the animations, and written as an array of
+ * {mesh, primitive, format, width, height, rowsPerFrame, frameCount, positions, normals} objects,
+ * where positions and normals refer to the texels using {bufferView, byteOffset, byteLength, min, max}.
+ *
+ * The glTF asset doesn't reference the texel accessors, so their buffer views get ids
+ * before the asset is written, see ExportableAsset::save.
+ */
+class ClipVertexAnimation : public GLTF::Object {
+  public:
+    ClipVertexAnimation(const Arguments &args, const ExportableScene &scene, size_t frameCount);
+    ~ClipVertexAnimation() override;
+
+    bool isEmpty() const { return m_primitives.empty(); }
+
+    // Samples the deformed meshes at the current time.
+    void sampleAt(size_t frameIndex);
+
+    // Packs the textures on worker threads, and creates their accessors.
+    void finish(const std::string &name);
+
+    void getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const;
+
+    void writeJSON(void *writer, GLTF::Options *options) override;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(ClipVertexAnimation);
+
+    struct Texture {
+        std::unique_ptr<VertexAnimationTexture> texture;
+        std::unique_ptr<GLTF::Accessor> accessor;
+    };
+
+    struct Primitive {
+        const ExportableMesh *mesh;
+        size_t sourceIndex;
+        Texture positions;
+        Texture normals;
+    };
+
+    struct Shape {
+        MDagPath dagPath;
+        float normalSign;
+        std::vector<size_t> primitiveIndices;
+    };
+
+    const Arguments &m_args;
+    const VertexAnimationFormat m_format;
+
+    std::vector<Shape> m_shapes;
+    std::vector<Primitive> m_primitives;
+
+    // Scratch buffers for the deformed points and normals of a shape
+    MPointArray m_points;
+    MFloatVectorArray m_normals;
+};
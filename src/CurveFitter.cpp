@@ -0,0 +1,166 @@
+#include "externals.h"
+
+#include "CurveFitter.h"
+
+CurveFitter::CurveFitter(const gsl::span<const float> times, const gsl::span<const float> values, const size_t dimension)
+    : dimension(dimension), sampleCount(times.size()), m_times(times), m_values(values) {
+    assert(dimension > 0);
+    assert(values.size() == sampleCount * dimension);
+}
+
+void CurveFitter::computeSlopes() const {
+    if (!m_slopes.empty())
+        return;
+
+    m_slopes.resize(m_values.size());
+
+    if (sampleCount < 2)
+        return;
+
+    for (size_t index = 0; index < sampleCount; ++index) {
+        // Central differences, one-sided at the end-points.
+        const auto prev = index > 0 ? index - 1 : index;
+        const auto next = index + 1 < sampleCount ? index + 1 : index;
+
+        const double dt = m_times[next] - m_times[prev];
+        const auto *v0 = sample(prev);
+        const auto *v1 = sample(next);
+        auto *slope = &m_slopes[index * dimension];
+
+        for (size_t axis = 0; axis < dimension; ++axis) {
+            slope[axis] = static_cast<float>((v1[axis] - v0[axis]) / dt);
+        }
+    }
+}
+
+template <typename SegmentError> std::vector<size_t> CurveFitter::selectKeys(const double tolerance, SegmentError segmentError) const {
+    std::vector<size_t> keys;
+
+    if (sampleCount == 0)
+        return keys;
+
+    std::vector<bool> isKey(sampleCount, false);
+    isKey.front() = true;
+    isKey.back() = true;
+
+    // Recursively split each segment at its worst sample, until all samples are within tolerance.
+    // An explicit stack is used, since clips can have many thousands of frames.
+    std::vector<std::pair<size_t, size_t>> segments;
+    segments.emplace_back(0, sampleCount - 1);
+
+    while (!segments.empty()) {
+        const auto segment = segments.back();
+        segments.pop_back();
+
+        const auto first = segment.first;
+        const auto last = segment.second;
+
+        double maxError = 0;
+        size_t worstIndex = first;
+
+        for (auto index = first + 1; index < last; ++index) {
+            const auto error = segmentError(first, last, index);
+            if (error > maxError) {
+                maxError = error;
+                worstIndex = index;
+            }
+        }
+
+        if (maxError > tolerance) {
+            isKey[worstIndex] = true;
+            segments.emplace_back(first, worstIndex);
+            segments.emplace_back(worstIndex, last);
+        }
+    }
+
+    for (size_t index = 0; index < sampleCount; ++index) {
+        if (isKey[index]) {
+            keys.push_back(index);
+        }
+    }
+
+    return keys;
+}
+
+double CurveFitter::linearError(const size_t first, const size_t last, const size_t index) const {
+    const double t0 = m_times[first];
+    const double t1 = m_times[last];
+    const double s = (m_times[index] - t0) / (t1 - t0);
+
+    const auto *v0 = sample(first);
+    const auto *v1 = sample(last);
+    const auto *v = sample(index);
+
+    double maxError = 0;
+
+    for (size_t axis = 0; axis < dimension; ++axis) {
+        const auto fitted = v0[axis] + s * (v1[axis] - v0[axis]);
+        maxError = std::max(maxError, std::abs(fitted - v[axis]));
+    }
+
+    return maxError;
+}
+
+double CurveFitter::cubicError(const size_t first, const size_t last, const size_t index) const {
+    const double t0 = m_times[first];
+    const double td = m_times[last] - t0;
+    const double s = (m_times[index] - t0) / td;
+    const double s2 = s * s;
+    const double s3 = s2 * s;
+
+    // Hermite basis, as in the glTF specification.
+    const auto h00 = 2 * s3 - 3 * s2 + 1;
+    const auto h10 = td * (s3 - 2 * s2 + s);
+    const auto h01 = -2 * s3 + 3 * s2;
+    const auto h11 = td * (s3 - s2);
+
+    const auto *v0 = sample(first);
+    const auto *v1 = sample(last);
+    const auto *b0 = slope(first);
+    const auto *a1 = slope(last);
+    const auto *v = sample(index);
+
+    double maxError = 0;
+
+    for (size_t axis = 0; axis < dimension; ++axis) {
+        const auto fitted = h00 * v0[axis] + h10 * b0[axis] + h01 * v1[axis] + h11 * a1[axis];
+        maxError = std::max(maxError, std::abs(fitted - v[axis]));
+    }
+
+    return maxError;
+}
+
+void CurveFitter::fitLinear(const double tolerance, FittedCurve &curve) const {
+    const auto keys = selectKeys(tolerance, [this](size_t first, size_t last, size_t index) { return linearError(first, last, index); });
+
+    curve.times.clear();
+    curve.values.clear();
+    curve.times.reserve(keys.size());
+    curve.values.reserve(keys.size() * dimension);
+
+    for (auto index : keys) {
+        const auto *v = sample(index);
+        curve.times.push_back(m_times[index]);
+        curve.values.insert(curve.values.end(), v, v + dimension);
+    }
+}
+
+void CurveFitter::fitCubic(const double tolerance, FittedCurve &curve) const {
+    computeSlopes();
+
+    const auto keys = selectKeys(tolerance, [this](size_t first, size_t last, size_t index) { return cubicError(first, last, index); });
+
+    curve.times.clear();
+    curve.values.clear();
+    curve.times.reserve(keys.size());
+    curve.values.reserve(keys.size() * dimension * 3);
+
+    for (auto index : keys) {
+        const auto *v = sample(index);
+        const auto *d = slope(index);
+        curve.times.push_back(m_times[index]);
+        curve.values.insert(curve.values.end(), d, d + dimension);
+        curve.values.insert(curve.values.end(), v, v + dimension);
+        curve.values.insert(curve.values.end(), d, d + dimension);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "macros.h"
+
+/** How sampled animation curves are reduced to keyframes */
+enum class KeyframeReduction {
+    /** Keep every sampled frame as a key */
+    None,
+    /** Drop samples that are reproduced by LINEAR interpolation within the tolerance */
+    Linear,
+    /** Fit CUBICSPLINE keys with in- and out-tangents within the tolerance */
+    Cubic
+};
+
+/** The keys of a fitted curve, laid out as a glTF animation sampler expects */
+struct FittedCurve {
+    /** The time of each key, in seconds */
+    std::vector<float> times;
+
+    /** For LINEAR keys, the values of each key. For CUBICSPLINE keys, the in-tangents, values and out-tangents of each key */
+    std::vector<float> values;
+
+    size_t keyCount() const { return times.size(); }
+};
+
+/**
+ * Reduces a densely sampled animation curve to a minimal set of keys,
+ * such that the reconstructed curve never deviates more than a given
+ * tolerance from any of the samples.
+ *
+ * The fitter doesn't depend on Maya, so it can be benchmarked standalone.
+ */
+class CurveFitter {
+  public:
+    /**
+     * @param times The time of each sample, in seconds, strictly increasing.
+     * @param values The components of each sample, dimension values per sample.
+     * @param dimension The number of components per sample.
+     */
+    CurveFitter(gsl::span<const float> times, gsl::span<const float> values, size_t dimension);
+    ~CurveFitter() = default;
+
+    const size_t dimension;
+    const size_t sampleCount;
+
+    /** Keeps only the samples needed to reproduce all samples by linear interpolation */
+    void fitLinear(double tolerance, FittedCurve &curve) const;
+
+    /** Fits Hermite segments using the slopes of the samples as tangents */
+    void fitCubic(double tolerance, FittedCurve &curve) const;
+
+  private:
+    const gsl::span<const float> m_times;
+    const gsl::span<const float> m_values;
+
+    // The slope of the curve at each sample, dimension values per sample. Only computed for cubic fitting.
+    mutable std::vector<float> m_slopes;
+
+    const float *sample(size_t index) const { return &m_values[index * dimension]; }
+    const float *slope(size_t index) const { return &m_slopes[index * dimension]; }
+
+    void computeSlopes() const;
+
+    template <typename SegmentError> std::vector<size_t> selectKeys(double tolerance, SegmentError segmentError) const;
+
+    double linearError(size_t first, size_t last, size_t index) const;
+    double cubicError(size_t first, size_t last, size_t index) const;
+
+    DISALLOW_COPY_MOVE_ASSIGN(CurveFitter);
+};
@@ -1,11 +1,14 @@
 #include "externals.h"
 
 #include "AccessorPacker.h"
+#include "AnimationBaseAsset.h"
 #include "Arguments.h"
+#include "AsyncFileWriter.h"
 #include "ExportableAsset.h"
+#include "GlbWriter.h"
 #include "filesystem.h"
+#include "outputFiles.h"
 #include "milo.h"
-#include "picosha2.h"
 #include "progress.h"
 #include "timeControl.h"
 #include "version.h"
@@ -40,6 +43,15 @@ ExportableAsset::ExportableAsset(const Arguments &args) : m_resources{args}, m_s
         remove_all(outputFolder);
     }
 
+    if (args.isAnimationOnly()) {
+        m_baseAsset = std::make_unique<AnimationBaseAsset>(args.animationBaseAsset.asChar());
+
+        // The buffers of the base asset are named after its scene, so its files would be overwritten by the exported files
+        const auto outputFilename = args.sceneName + "." + (args.glb ? args.glbFileExtension : args.gltfFileExtension);
+        if (m_baseAsset->isBasePath((outputFolder / outputFilename.asChar()).string()))
+            throw std::runtime_error("The animation-only export would replace its base asset " + std::string(args.animationBaseAsset.asChar()));
+    }
+
     const auto currentFrameTime = MAnimControl::currentTime();
 
     setCurrentTime(args.initialValuesTime, args.redrawViewport);
@@ -64,23 +76,66 @@ ExportableAsset::ExportableAsset(const Arguments &args) : m_resources{args}, m_s
         m_scene.getNode(dagPath);
     }
 
+    if (m_baseAsset) {
+        // Also export the other nodes of the base asset, like the joints, which are otherwise found through the skin clusters.
+        MStatus status;
+        MItDag dagIterator(MItDag::kDepthFirst, MFn::kTransform, &status);
+        THROW_ON_FAILURE(status);
+
+        for (; !dagIterator.isDone(); dagIterator.next()) {
+            MDagPath dagPath;
+            THROW_ON_FAILURE(dagIterator.getPath(dagPath));
+
+            const MFnDependencyNode fnNode(dagPath.node());
+            if (m_baseAsset->hasMayaNode(args.gltfName(fnNode, ""))) {
+                m_scene.getNode(dagPath);
+            }
+        }
+    }
+
     if (!args.keepShapeNodes) {
         m_scene.mergeRedundantShapeNodes();
     }
 
+    if (!args.animationClips.empty()) {
+        m_scene.computeAnimationTolerances();
+    }
+
     // Now export animation clips of all the nodes, in one pass over the slow
     // timeline
     const auto clipCount = args.animationClips.size();
 
     if (clipCount) {
         for (auto &clipArg : args.animationClips) {
-            uiAdvanceProgress("exporting clip " + clipArg.name);
-            auto clip = std::make_unique<ExportableClip>(args, clipArg, m_scene);
-            if (!clip->glAnimation.channels.empty()) {
-                m_glAsset.animations.push_back(&clip->glAnimation);
-                m_clips.emplace_back(std::move(clip));
+            const auto isChunked = args.clipChunkSeconds > 0;
+            const auto chunkArgs = isChunked ? clipArg.chunks(args.clipChunkSeconds) : std::vector<AnimClipArg>{clipArg};
+
+            for (auto &chunkArg : chunkArgs) {
+                uiAdvanceProgress("exporting clip " + chunkArg.name);
+
+                if (isChunked) {
+                    m_chunkTimeAccessors.emplace_back(std::make_unique<TimeAccessorPool>());
+                }
+
+                auto &timeAccessors = isChunked ? *m_chunkTimeAccessors.back() : m_timeAccessors;
+                auto clip = std::make_unique<ExportableClip>(args, chunkArg, m_scene, timeAccessors);
+                if (!clip->glAnimation.channels.empty()) {
+                    m_glAsset.animations.push_back(&clip->glAnimation);
+
+                    if (isChunked) {
+                        const auto startSeconds = (chunkArg.startTime - clipArg.startTime).as(MTime::kSeconds);
+                        const auto durationSeconds = (chunkArg.frameCount() - 1) / chunkArg.framesPerSecond;
+                        m_clipChunks.add(clipArg.name, &clip->glAnimation, startSeconds, durationSeconds);
+                    }
+
+                    m_clips.emplace_back(std::move(clip));
+                }
             }
         }
+
+        if (!m_clipChunks.isEmpty()) {
+            m_glAsset.extras["clipChunks"] = &m_clipChunks;
+        }
     } else if (currentFrameTime != args.initialValuesTime) {
         // When we export just a single frame, we normally bake the geometry at
         // that frame. However, when explicitly specifying a different
@@ -125,22 +180,124 @@ ExportableAsset::Cleanup::Cleanup() : currentTime{MAnimControl::currentTime()} {
 
 ExportableAsset::Cleanup::~Cleanup() { setCurrentTime(currentTime, true); }
 
+// Pretty formats the JSON by feeding the events of a SAX reader straight to a pretty writer, without building a document
+template <typename OutputStream>
+static bool writePrettyJson(const std::string &json, OutputStream &outputStream) {
+    rapidjson::StringStream jsonStream(json.c_str());
+    rapidjson::PrettyWriter<OutputStream> jsonPrettyWriter(outputStream);
+    rapidjson::Reader jsonReader;
+    return !jsonReader.Parse(jsonStream, jsonPrettyWriter).IsError();
+}
+
+// The buffer views and buffers of the accessors that the asset doesn't reference, like the indices and values of sparse
+// accessors and the texels of vertex animation textures. The glTF asset only writes the buffer views of its own accessors
+// and images, so these get the ids that follow, and are appended to the JSON after the asset is written.
+struct DetachedBufferViews {
+    size_t firstViewId = 0;
+    size_t firstBufferId = 0;
+    std::vector<GLTF::BufferView *> views;
+    std::vector<GLTF::Buffer *> buffers;
+};
+
+// Assigns ids to the buffer views and buffers that the asset doesn't write, before the asset is written,
+// so the detached accessors can refer to these while the asset is written.
+static DetachedBufferViews assignDetachedIds(GLTF::Asset &asset, const std::vector<GLTF::Accessor *> &detachedAccessors) {
+    std::set<GLTF::BufferView *> assetViews;
+    std::set<GLTF::Buffer *> assetBuffers;
+
+    const auto addAssetView = [&](GLTF::BufferView *view) {
+        if (view && assetViews.insert(view).second) {
+            assetBuffers.insert(view->buffer);
+        }
+    };
+
+    for (auto *accessor : asset.getAllAccessors()) {
+        addAssetView(accessor->bufferView);
+    }
+
+    for (auto *image : asset.getAllImages()) {
+        addAssetView(image->bufferView);
+    }
+
+    DetachedBufferViews detached;
+    detached.firstViewId = assetViews.size();
+    detached.firstBufferId = assetBuffers.size();
+
+    for (auto *accessor : detachedAccessors) {
+        auto *view = accessor->bufferView;
+        if (!view || assetViews.count(view) || view->id >= 0)
+            continue;
+
+        view->id = static_cast<int>(detached.firstViewId + detached.views.size());
+        detached.views.push_back(view);
+
+        auto *buffer = view->buffer;
+        if (!assetBuffers.count(buffer) && buffer->id < 0) {
+            buffer->id = static_cast<int>(detached.firstBufferId + detached.buffers.size());
+            detached.buffers.push_back(buffer);
+        }
+    }
+
+    return detached;
+}
+
+// Appends the detached buffer views and buffers to the JSON written by the asset.
+static void appendDetachedBufferViews(std::string &json, const DetachedBufferViews &detached, GLTF::Options &options) {
+    if (detached.views.empty())
+        return;
+
+    rapidjson::Document document;
+    if (document.Parse(json.c_str()).HasParseError())
+        throw std::runtime_error("Failed to parse the glTF JSON");
+
+    auto &allocator = document.GetAllocator();
+
+    const auto append = [&](const char *key, const size_t firstId, const auto &objects) {
+        if (objects.empty())
+            return;
+
+        if (!document.HasMember(key)) {
+            document.AddMember(rapidjson::Value(key, allocator), rapidjson::Value(rapidjson::kArrayType), allocator);
+        }
+
+        auto &array = document[key];
+
+        // The ids were assigned assuming the asset writes all its own buffer views and buffers
+        if (!array.IsArray() || array.Size() != firstId)
+            throw std::runtime_error(std::string("The glTF asset wrote an unexpected number of ") + key);
+
+        for (auto *object : objects) {
+            rapidjson::StringBuffer objectBuffer;
+            rapidjson::Writer<rapidjson::StringBuffer> objectWriter(objectBuffer);
+            objectWriter.StartObject();
+            object->writeJSON(&objectWriter, &options);
+            objectWriter.EndObject();
+
+            rapidjson::Document objectDocument;
+            objectDocument.Parse(objectBuffer.GetString());
+            array.PushBack(rapidjson::Value(objectDocument, allocator), allocator);
+        }
+    };
+
+    append("bufferViews", detached.firstViewId, detached.views);
+    append("buffers", detached.firstBufferId, detached.buffers);
+
+    rapidjson::StringBuffer jsonBuffer;
+    rapidjson::Writer<rapidjson::StringBuffer> jsonWriter(jsonBuffer);
+    document.Accept(jsonWriter);
+
+    json = jsonBuffer.GetString();
+}
+
 const std::string &ExportableAsset::prettyJsonString() const {
     if (m_prettyJsonString.empty() && !m_rawJsonString.empty()) {
-        // Pretty format the JSON
-        rapidjson::Document jsonDocument;
-        const bool hasParseErrors = jsonDocument.Parse(m_rawJsonString.c_str()).HasParseError();
+        rapidjson::StringBuffer jsonPrettyBuffer;
 
-        if (hasParseErrors) {
+        if (writePrettyJson(m_rawJsonString, jsonPrettyBuffer)) {
+            m_prettyJsonString = jsonPrettyBuffer.GetString();
+        } else {
             cerr << prefix << "Failed to reformat glTF JSON, outputting raw JSON" << endl;
             m_prettyJsonString = m_rawJsonString;
-        } else {
-            rapidjson::StringBuffer jsonPrettyBuffer;
-
-            // Write the pretty JSON
-            rapidjson::PrettyWriter<rapidjson::StringBuffer> jsonPrettyWriter(jsonPrettyBuffer);
-            jsonDocument.Accept(jsonPrettyWriter);
-            m_prettyJsonString = jsonPrettyBuffer.GetString();
         }
     }
 
@@ -172,7 +329,26 @@ void ExportableAsset::save() {
     // Last try, this will throw an exception if it fails.
     create_directories(outputFolder);
 
-    const auto allAccessors = m_glAsset.getAllAccessors();
+    auto allAccessors = m_glAsset.getAllAccessors();
+
+    // The clips also have accessors that are not referenced by the asset,
+    // like the indices and values of sparse accessors, and vertex animation textures.
+    std::set<GLTF::Accessor *> allAccessorSet(allAccessors.begin(), allAccessors.end());
+    std::vector<GLTF::Accessor *> detachedAccessors;
+
+    std::vector<std::vector<GLTF::Accessor *>> accessorsPerClip(m_clips.size());
+
+    for (size_t clipIndex = 0; clipIndex < m_clips.size(); ++clipIndex) {
+        auto &clipAccessors = accessorsPerClip[clipIndex];
+        m_clips[clipIndex]->getAllAccessors(clipAccessors);
+
+        for (auto *accessor : clipAccessors) {
+            if (allAccessorSet.insert(accessor).second) {
+                allAccessors.emplace_back(accessor);
+                detachedAccessors.emplace_back(accessor);
+            }
+        }
+    }
 
     if (args.dumpAccessorComponents) {
         dumpAccessorComponents(allAccessors);
@@ -187,9 +363,71 @@ void ExportableAsset::save() {
 
     AccessorPacker bufferPacker;
 
+    // The detached accessors get buffer views of their own, so these can get ids before the asset is written
+    bufferPacker.packSeparately(detachedAccessors);
+
+    if (args.mappedOutput && !args.glb) {
+        bufferPacker.mapBuffersTo(outputFolder.string());
+    }
+
+    if (args.hashBufferURIs && !args.glb) {
+        bufferPacker.hashBuffersWith(args.hashAlgorithm);
+    }
+
+    if (args.maxBufferSize > 0) {
+        bufferPacker.limitBufferSize(static_cast<size_t>(args.maxBufferSize * 1024 * 1024));
+    }
+
+    if (args.vertexLayout != VertexBufferLayout::Planar) {
+        std::vector<std::vector<GLTF::Accessor *>> vertexStreams;
+        m_scene.getVertexStreams(args.vertexLayout, vertexStreams);
+
+        for (auto &&vertexStream : vertexStreams) {
+            bufferPacker.interleave(vertexStream);
+        }
+    }
+
     PackedBufferMap packedBufferMap;
 
-    if (!args.glb && !args.separateAccessorBuffers && args.splitMeshAnimation) {
+    // Writes the binary chunk of the GLB file straight from the accessors and images, without packing these first.
+    GlbWriter glbWriter;
+
+    if (!args.glb && !args.separateAccessorBuffers && !m_clipChunks.isEmpty()) {
+        // Pack each clip chunk into its own buffer, so a player can start playing after loading the first chunk.
+        // The chunks don't share accessors, but the accessors of a chunk can occur more than once.
+        std::set<GLTF::Accessor *> chunkAccessorSet;
+
+        for (size_t clipIndex = 0; clipIndex < m_clips.size(); ++clipIndex) {
+            std::vector<GLTF::Accessor *> chunkAccessors;
+
+            for (auto *accessor : accessorsPerClip[clipIndex]) {
+                if (chunkAccessorSet.insert(accessor).second) {
+                    chunkAccessors.emplace_back(accessor);
+                }
+            }
+
+            auto &glAnimation = m_clips[clipIndex]->glAnimation;
+            const auto chunkBufferName = sceneName + "/" + glAnimation.name;
+            const auto chunkBuffers = bufferPacker.packAccessors(chunkAccessors, chunkBufferName);
+            for (auto *chunkBuffer : chunkBuffers) {
+                packedBufferMap[chunkBuffer] = chunkBufferName;
+            }
+            m_clipChunks.setBuffers(&glAnimation, chunkBuffers);
+        }
+
+        // The remaining accessors are the mesh accessors
+        std::vector<GLTF::Accessor *> meshAccessors;
+        for (auto *accessor : allAccessors) {
+            if (chunkAccessorSet.find(accessor) == chunkAccessorSet.end()) {
+                meshAccessors.emplace_back(accessor);
+            }
+        }
+
+        const auto meshBufferName = sceneName + "/mesh";
+        for (auto *meshBuffer : bufferPacker.packAccessors(meshAccessors, meshBufferName)) {
+            packedBufferMap[meshBuffer] = meshBufferName;
+        }
+    } else if (!args.glb && !args.separateAccessorBuffers && args.splitMeshAnimation) {
         // Combine mesh and clip accessors into two separate buffers
 
         // Gather mesh accessors, per dag-path
@@ -216,8 +454,7 @@ void ExportableAsset::save() {
 
         // TODO: Also associate clips with dag-paths!
         const auto animBufferName = sceneName + "/anim";
-        const auto animBuffer = bufferPacker.packAccessors(animAccessors, animBufferName);
-        if (animBuffer) {
+        for (auto *animBuffer : bufferPacker.packAccessors(animAccessors, animBufferName)) {
             packedBufferMap[animBuffer] = animBufferName;
         }
     } else if (!args.glb && args.separateAccessorBuffers) {
@@ -246,19 +483,26 @@ void ExportableAsset::save() {
             }
         }
 
-        const auto buffer = bufferPacker.packAccessors(allAccessors, bufferName, imageBufferLength);
+        const auto buffers = bufferPacker.packAccessors(allAccessors, bufferName, imageBufferLength, args.glb ? &glbWriter : nullptr);
 
-        if (buffer) {
-            if (imageBufferLength) {
-                // Copy images to buffer, and create image buffer-views
-                size_t byteOffset = buffer->byteLength - imageBufferLength;
-                for (GLTF::Image *image : images) {
-                    const auto bufferView = new GLTF::BufferView(byteOffset, image->byteLength, buffer);
-                    image->bufferView = bufferView;
+        if (imageBufferLength) {
+            // Only the first buffer reserved the space for the images.
+            // Copy images to buffer (or let the GLB writer write these), and create image buffer-views
+            auto *buffer = buffers.front();
+            size_t byteOffset = buffer->byteLength - imageBufferLength;
+            for (GLTF::Image *image : images) {
+                const auto bufferView = new GLTF::BufferView(byteOffset, image->byteLength, buffer);
+                image->bufferView = bufferView;
+                if (args.glb) {
+                    glbWriter.addBinary(byteOffset, image->data, image->byteLength);
+                } else {
                     std::memcpy(buffer->data + byteOffset, image->data, image->byteLength);
-                    byteOffset += image->byteLength;
                 }
+                byteOffset += image->byteLength;
             }
+        }
+
+        for (auto *buffer : buffers) {
             packedBufferMap[buffer] = bufferName;
         }
     }
@@ -289,13 +533,18 @@ void ExportableAsset::save() {
         }
     }
 
-    if (args.hashBufferURIs) {
-        // Generate hash buffer URIs
+    if (args.hashBufferURIs && !args.glb) {
+        // Generate hash buffer URIs. The binary chunk of a GLB file has no URI
         for (const auto &pair : packedBufferMap) {
             auto buffer = pair.first;
 
-            std::string hash_hex_str;
-            picosha2::hash256_hex_string(buffer->data, buffer->data + buffer->byteLength, hash_hex_str);
+            // Hashed by the packer, while packing. Buffers that were not packed, like separate accessor buffers, are hashed here.
+            auto hash_hex_str = bufferPacker.bufferHash(buffer);
+            if (hash_hex_str.empty()) {
+                const auto hasher = BufferHasher::create(args.hashAlgorithm);
+                hasher->process(buffer->data, static_cast<size_t>(buffer->byteLength));
+                hash_hex_str = hasher->hexDigest();
+            }
 
             std::string filename = pair.second;
             makeValidFilename(filename);
@@ -307,6 +556,18 @@ void ExportableAsset::save() {
         }
     }
 
+    // Writes the images, buffers and shaders concurrently, while the JSON is generated and written.
+    AsyncFileWriter fileWriter(args.skipUnchangedFiles);
+
+    if (!options.embeddedTextures) {
+        for (GLTF::Image *image : m_glAsset.getAllImages()) {
+            fs::path uri = outputFolder / image->uri;
+            fileWriter.write(uri.generic_string(), image->data, image->byteLength);
+        }
+    }
+
+    const auto detachedBufferViews = assignDetachedIds(m_glAsset, detachedAccessors);
+
     // Generate glTF JSON file
     rapidjson::StringBuffer jsonStringBuffer;
     rapidjson::Writer<rapidjson::StringBuffer> jsonWriter(jsonStringBuffer);
@@ -317,30 +578,38 @@ void ExportableAsset::save() {
 
     m_rawJsonString = jsonStringBuffer.GetString();
 
-    const auto outputFilename = args.sceneName + "." + (args.glb ? args.glbFileExtension : args.gltfFileExtension);
-    const auto outputPath = outputFolder / outputFilename.asChar();
+    appendDetachedBufferViews(m_rawJsonString, detachedBufferViews, options);
 
-    cout << prefix << "Writing glTF file to '" << outputPath << "'" << endl;
+    AnimationBaseAsset::Merged mergedAsset;
 
-    if (!options.embeddedTextures) {
-        for (GLTF::Image *image : m_glAsset.getAllImages()) {
-            fs::path uri = outputFolder / image->uri;
-            std::ofstream file;
-            create(file, uri.generic_string(), ios::out | ios::binary);
-            file.write(reinterpret_cast<char *>(image->data), image->byteLength);
-            file.close();
+    if (m_baseAsset) {
+        // A GLB base asset has a binary chunk, that is written to a separate buffer when the output is not a GLB
+        auto baseBinaryUri = sceneName + "/base";
+        makeValidFilename(baseBinaryUri);
+        baseBinaryUri += ".bin";
+
+        mergedAsset = m_baseAsset->merge(m_rawJsonString, glbWriter.binaryLength(), outputFolder.string(), baseBinaryUri, args.glb);
+        m_rawJsonString = mergedAsset.json;
+
+        if (args.glb) {
+            glbWriter.prependBinary(mergedAsset.exportedByteOffset, mergedAsset.binaryChunk.data(), mergedAsset.binaryChunk.size());
+        } else if (!mergedAsset.binaryChunk.empty()) {
+            fileWriter.write((outputFolder / baseBinaryUri).generic_string(), mergedAsset.binaryChunk.data(), mergedAsset.binaryChunk.size());
         }
     }
 
+    const auto outputFilename = args.sceneName + "." + (args.glb ? args.glbFileExtension : args.gltfFileExtension);
+    const auto outputPath = outputFolder / outputFilename.asChar();
+
+    cout << prefix << "Writing glTF file to '" << outputPath << "'" << endl;
+
     if (!options.embeddedBuffers) {
         for (const auto &pair : packedBufferMap) {
             const auto buffer = pair.first;
-            if (buffer->data && buffer->byteLength) {
-                fs::path uri = outputFolder / buffer->uri;
-                std::ofstream file;
-                create(file, uri.generic_string(), ios::out | ios::binary);
-                file.write(reinterpret_cast<char *>(buffer->data), buffer->byteLength);
-                file.close();
+            fs::path uri = outputFolder / buffer->uri;
+            // A buffer packed into a memory-mapped file only needs to be moved to its URI
+            if (!bufferPacker.commitMappedBuffer(buffer, uri.generic_string(), args.skipUnchangedFiles) && buffer->data && buffer->byteLength) {
+                fileWriter.write(uri.generic_string(), buffer->data, buffer->byteLength);
             }
         }
     }
@@ -348,71 +617,49 @@ void ExportableAsset::save() {
     if (!options.embeddedShaders) {
         for (GLTF::Shader *shader : m_glAsset.getAllShaders()) {
             fs::path uri = outputFolder / shader->uri;
-            std::ofstream file;
-            create(file, uri.generic_string(), ios::out | ios::binary);
-            file.write(shader->source.c_str(), shader->source.length());
-            file.close();
+            fileWriter.write(uri.generic_string(), shader->source.c_str(), shader->source.length());
         }
     }
 
     // Write glTF file.
-    {
-        const auto &jsonString = m_rawJsonString;
-
+    if (args.glb) {
+        if (packedBufferMap.size() > 1)
+            throw std::runtime_error("A glb file can only have one binary buffer");
+        glbWriter.write(outputPath.string(), m_rawJsonString, args.skipUnchangedFiles);
+    } else if (args.skipUnchangedFiles) {
+        // Format the JSON in memory, to compare it with the file
+        const auto &jsonString = args.compactJson ? m_rawJsonString : prettyJsonString();
+        const auto jsonData = reinterpret_cast<const uint8_t *>(jsonString.data());
+        const uint8_t newline[] = {'\n'};
+
+        if (!writeChangedFile(outputPath.string(), {gsl::make_span(jsonData, jsonData + jsonString.size()), gsl::make_span(newline)})) {
+            cout << prefix << "Skipped unchanged '" << outputPath.string() << "'" << endl;
+        }
+    } else {
         std::ofstream file;
-        create(file, outputPath.string(), ios::out | (args.glb ? ios::binary : std::ios_base::openmode(0)));
-
-        if (args.glb) {
-            assert(packedBufferMap.size() <= 1);
-            const auto maybeBuffer = packedBufferMap.empty() ? nullptr : packedBufferMap.begin()->first;
-            const auto bufferLength = maybeBuffer ? maybeBuffer->byteLength : 0;
-
-            file.write("glTF", 4); // magic header
-
-            const auto writeHeader = new uint32_t[2];
-            writeHeader[0] = 2; // version
-
-            const int jsonLength = static_cast<int>(jsonString.length());
-            const int jsonPadding = (4 - (jsonLength & 3)) & 3;
-            const int binPadding = (4 - (bufferLength & 3)) & 3;
+        create(file, outputPath.string(), ios::out);
 
-            const int headerLength = 12;
-            const int chunkHeaderLength = 8;
-
-            const int dataChunkSize = bufferLength ? (chunkHeaderLength + bufferLength + binPadding) : 0;
-
-            writeHeader[1] = headerLength + (chunkHeaderLength + jsonLength + jsonPadding) + dataChunkSize; // length
-
-            file.write(reinterpret_cast<char *>(writeHeader),
-                       sizeof(uint32_t) * 2); // GLB header
-
-            writeHeader[0] = jsonLength + jsonPadding; // chunkLength
-            writeHeader[1] = 0x4E4F534A;               // chunkType JSON
-            file.write(reinterpret_cast<char *>(writeHeader), sizeof(uint32_t) * 2);
-
-            file.write(jsonString.c_str(), jsonLength);
-            for (int i = 0; i < jsonPadding; i++) {
-                file.write(" ", 1);
-            }
-
-            if (bufferLength) {
-                writeHeader[0] = bufferLength + binPadding; // chunkLength
-                writeHeader[1] = 0x004E4942;                // chunkType BIN
-                file.write(reinterpret_cast<char *>(writeHeader), sizeof(uint32_t) * 2);
+        if (args.compactJson) {
+            file << m_rawJsonString;
+        } else {
+            // Stream the pretty JSON straight to the file, without a pretty copy in memory
+            rapidjson::OStreamWrapper fileStream(file);
 
-                file.write(reinterpret_cast<char *>(maybeBuffer->data), bufferLength);
-                for (int i = 0; i < binPadding; i++) {
-                    file.write("\0", 1);
-                }
+            if (!writePrettyJson(m_rawJsonString, fileStream)) {
+                cerr << prefix << "Failed to reformat glTF JSON, outputting raw JSON" << endl;
+                file.close();
+                create(file, outputPath.string(), ios::out | ios::trunc);
+                file << m_rawJsonString;
             }
-
-        } else {
-            file << prettyJsonString() << endl;
         }
 
+        file << endl;
         file.close();
     }
 
+    // Wait for the other files, reporting any failures in the order they were written
+    fileWriter.join();
+
     if (args.dumpGLTF) {
         auto &out = *args.dumpGLTF;
         out << "glTF dump:" << endl;
@@ -460,9 +707,9 @@ void ExportableAsset::packMeshAccessors(AccessorsPerDagPath &accessorsPerDagPath
             auto refStem = refPath.stem().generic_string();
 
             const auto bufferName = refStem + nameSuffix;
-            const auto buffer = packer.packAccessors(refAccessors, bufferName);
-
-            packedBufferMap[buffer] = bufferName;
+            for (auto *buffer : packer.packAccessors(refAccessors, bufferName)) {
+                packedBufferMap[buffer] = bufferName;
+            }
         }
 
         if (!remainingAccessorsPerDagPath.empty()) {
@@ -483,9 +730,7 @@ void ExportableAsset::packMeshAccessors(AccessorsPerDagPath &accessorsPerDagPath
         }
 
         const auto bufferName = args.sceneName.asChar() + nameSuffix;
-        const auto buffer = packer.packAccessors(flatAccessors, bufferName);
-
-        if (buffer) {
+        for (auto *buffer : packer.packAccessors(flatAccessors, bufferName)) {
             packedBufferMap[buffer] = bufferName;
         }
     }
@@ -557,6 +802,10 @@ void ExportableAsset::dumpAccessorComponents(const std::vector<GLTF::Accessor *>
     int fileIndex = 0;
 
     for (auto &&accessor : accessors) {
+        // Sparse accessors are dumped through their indices and values.
+        if (!accessor->bufferView)
+            continue;
+
         switch (accessor->componentType) {
         case WebGL::FLOAT:
             dumpAccessorComponentValues<float>(accessor, fileIndex, false);
@@ -1,4 +1,6 @@
 #pragma once
+#include "AnimationBaseAsset.h"
+#include "ClipChunkManifest.h"
 #include "ExportableClip.h"
 #include "ExportableResources.h"
 #include "ExportableScene.h"
@@ -34,12 +36,25 @@ class ExportableAsset {
     GLTF::Node m_glRootNode;
     GLTF::Node::TransformTRS m_glRootTransform;
 
+    // The asset whose animations are replaced, for animation-only exports
+    std::unique_ptr<AnimationBaseAsset> m_baseAsset;
+
     ExportableResources m_resources;
     ExportableScene m_scene;
 
+    // The input accessors of all clips, these are shared between clips and channels.
+    TimeAccessorPool m_timeAccessors;
+
+    // The input accessors of each clip chunk, these are only shared within a chunk,
+    // so each chunk is stored in its own buffer.
+    std::vector<std::unique_ptr<TimeAccessorPool>> m_chunkTimeAccessors;
+
     // std::vector<std::unique_ptr<ExportableItem>> m_items;
     std::vector<std::unique_ptr<ExportableClip>> m_clips;
 
+    // How the clips were split into chunks, see Arguments::clipChunkSeconds
+    ClipChunkManifest m_clipChunks;
+
     std::string m_rawJsonString;
     mutable std::string m_prettyJsonString;
 
@@ -2,11 +2,13 @@
 
 #include "ExportableClip.h"
 #include "ExportableNode.h"
+#include "SparseAccessor.h"
 #include "progress.h"
 #include "timeControl.h"
 
-ExportableClip::ExportableClip(const Arguments &args, const AnimClipArg &clipArg, const ExportableScene &scene)
-    : m_frames(args.makeName(clipArg.name + "/anim/frames"), clipArg.frameCount(), clipArg.framesPerSecond) {
+ExportableClip::ExportableClip(const Arguments &args, const AnimClipArg &clipArg, const ExportableScene &scene, TimeAccessorPool &timeAccessors)
+    : m_sampleStore(args.streamSamples ? std::make_unique<SampleStore>() : nullptr)
+    , m_frames(timeAccessors, m_sampleStore.get(), args.makeName(clipArg.name + "/anim/frames"), clipArg.frameCount(), clipArg.framesPerSecond) {
     glAnimation.name = clipArg.name;
 
     const auto stepDetectSampleCount = args.getStepDetectSampleCount();
@@ -25,6 +27,31 @@ ExportableClip::ExportableClip(const Arguments &args, const AnimClipArg &clipArg
         }
     }
 
+    // Sample the nodes parent first, so the transforms of parents are cached before their children need them.
+    std::vector<NodeAnimation *> samplingOrder;
+    samplingOrder.reserve(m_nodeAnimations.size());
+    for (auto &nodeAnimation : m_nodeAnimations) {
+        samplingOrder.push_back(nodeAnimation.get());
+    }
+
+    std::sort(samplingOrder.begin(), samplingOrder.end(), [](const NodeAnimation *a, const NodeAnimation *b) { return a->node.index < b->node.index; });
+
+    std::vector<const ExportableNode *> sampledNodes;
+    sampledNodes.reserve(samplingOrder.size());
+    for (auto *nodeAnimation : samplingOrder) {
+        sampledNodes.push_back(&nodeAnimation->node);
+    }
+
+    NodeTransformCache transformCache;
+
+    if (args.clipBounds) {
+        m_bounds = std::make_unique<ClipBounds>(args, scene, span(samplingOrder));
+    }
+
+    if (args.vertexAnimationFormat != VertexAnimationFormat::None) {
+        m_vertexAnimation = std::make_unique<ClipVertexAnimation>(args, scene, frameCount);
+    }
+
     const auto superSampleFrameRate = stepDetectSampleCount * clipArg.framesPerSecond;
 
     // To make sure Maya never rounds to just before a frame, we add half the smallest time step. Need to detect step interpolation
@@ -37,10 +64,20 @@ ExportableClip::ExportableClip(const Arguments &args, const AnimClipArg &clipArg
             setCurrentTime(absoluteFrameTime, args.redrawViewport && superSampleIndex == 0);
             // const auto absoluteFrameTimeDebug = MAnimControl::currentTime().as(MTime::k24FPS);
 
-            NodeTransformCache transformCache;
-            for (auto &nodeAnimation : m_nodeAnimations) {
+            transformCache.reset();
+            transformCache.evaluate(span(sampledNodes), scaleFactor, args.posPrecision, args.sclPrecision, args.dirPrecision);
+
+            for (auto *nodeAnimation : samplingOrder) {
                 nodeAnimation->sampleAt(absoluteFrameTime, relativeFrameIndex, superSampleIndex, transformCache);
             }
+
+            if (m_bounds && superSampleIndex == 0) {
+                m_bounds->sample(transformCache);
+            }
+
+            if (m_vertexAnimation && superSampleIndex == 0) {
+                m_vertexAnimation->sampleAt(relativeFrameIndex);
+            }
         }
 
         if (relativeFrameIndex % checkProgressFrameInterval == checkProgressFrameInterval - 1) {
@@ -51,6 +88,38 @@ ExportableClip::ExportableClip(const Arguments &args, const AnimClipArg &clipArg
     for (auto &nodeAnimation : m_nodeAnimations) {
         nodeAnimation->exportTo(glAnimation);
     }
+
+    if (m_bounds && !m_bounds->isEmpty()) {
+        glAnimation.extras["bounds"] = m_bounds.get();
+    }
+
+    // Without channels, the clip is not exported, so its texels would not get a buffer view.
+    if (m_vertexAnimation && !m_vertexAnimation->isEmpty() && !glAnimation.channels.empty()) {
+        m_vertexAnimation->finish(args.makeName(clipArg.name));
+        glAnimation.extras["vertexAnimation"] = m_vertexAnimation.get();
+    } else {
+        m_vertexAnimation.reset();
+    }
 }
 
 ExportableClip::~ExportableClip() = default;
+
+void ExportableClip::getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const {
+    for (auto *channel : glAnimation.channels) {
+        for (auto *accessor : {channel->sampler->input, channel->sampler->output}) {
+            accessors.emplace_back(accessor);
+
+            // The indices and values of sparse accessors are not referenced by the asset.
+            if (auto sparseAccessor = dynamic_cast<SparseAccessor *>(accessor)) {
+                if (sparseAccessor->indices()) {
+                    accessors.emplace_back(sparseAccessor->indices());
+                    accessors.emplace_back(sparseAccessor->values());
+                }
+            }
+        }
+    }
+
+    if (m_vertexAnimation) {
+        m_vertexAnimation->getAllAccessors(accessors);
+    }
+}
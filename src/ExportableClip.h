@@ -1,19 +1,28 @@
 #pragma once
 
 #include "Arguments.h"
+#include "ClipBounds.h"
+#include "ClipVertexAnimation.h"
 #include "ExportableFrames.h"
 #include "NodeAnimation.h"
 
 class ExportableClip {
   public:
-    ExportableClip(const Arguments &args, const AnimClipArg &clipArg, const ExportableScene &scene);
+    ExportableClip(const Arguments &args, const AnimClipArg &clipArg, const ExportableScene &scene, TimeAccessorPool &timeAccessors);
     virtual ~ExportableClip();
 
     GLTF::Animation glAnimation;
 
+    // All accessors of the clip, including those that are only referenced indirectly. Shared accessors can occur more than once.
+    void getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const;
+
   private:
+    // Holds the animation samples when streaming them to a temporary file, must outlive the node animations.
+    std::unique_ptr<SampleStore> m_sampleStore;
     ExportableFrames m_frames;
     std::vector<std::unique_ptr<NodeAnimation>> m_nodeAnimations;
+    std::unique_ptr<ClipBounds> m_bounds;
+    std::unique_ptr<ClipVertexAnimation> m_vertexAnimation;
 
     DISALLOW_COPY_MOVE_ASSIGN(ExportableClip);
 };
@@ -3,10 +3,12 @@
 #include "ExportableFrames.h"
 #include "accessors.h"
 
-ExportableFrames::ExportableFrames(std::string accessorName,
+ExportableFrames::ExportableFrames(TimeAccessorPool &timeAccessors,
+                                   SampleStore *sampleStore,
+                                   std::string accessorName,
                                    const int frameCount,
                                    const double framesPerSecond)
-    : count(frameCount), m_accessorName(std::move(accessorName)) {
+    : count(frameCount), m_timeAccessors(timeAccessors), m_sampleStore(sampleStore), m_accessorName(std::move(accessorName)) {
     m_glTimes.reserve(frameCount);
 
     for (auto relativeFrameIndex = 0; relativeFrameIndex < frameCount; ++relativeFrameIndex) {
@@ -17,17 +19,21 @@ ExportableFrames::ExportableFrames(std::string accessorName,
 
 GLTF::Accessor *ExportableFrames::glInputs() const {
     if (!m_glInputs) {
-        m_glInputs = contiguousChannelAccessor(m_accessorName, m_glTimes, 1);
+        m_glInputs = m_timeAccessors.get(m_accessorName, m_glTimes);
     }
 
-    return m_glInputs.get();
+    return m_glInputs;
 }
 
 GLTF::Accessor *ExportableFrames::glInput0() const {
     if (!m_glInput0) {
-        m_glInput0 = contiguousChannelAccessor(m_accessorName, span(m_glTimes).subspan(0, 1), 1);
+        m_glInput0 = m_timeAccessors.get(m_accessorName, span(m_glTimes).subspan(0, 1));
     }
 
-    return m_glInput0.get();
+    return m_glInput0;
+}
+
+GLTF::Accessor *ExportableFrames::glKeyInputs(const std::string &accessorName, const gsl::span<const float> keyTimes) const {
+    return m_timeAccessors.get(accessorName, keyTimes);
 }
 
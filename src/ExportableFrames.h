@@ -1,26 +1,40 @@
 #pragma once
 
+#include "SampleStore.h"
+#include "TimeAccessorPool.h"
 #include "macros.h"
 
 class ExportableFrames {
   public:
-    ExportableFrames(std::string accessorName, int frameCount, double framesPerSecond);
+    ExportableFrames(TimeAccessorPool &timeAccessors, SampleStore *sampleStore, std::string accessorName, int frameCount, double framesPerSecond);
     ~ExportableFrames() = default;
 
     const int count;
 
+    /** For each animation frame, the clip-relative time in seconds */
+    gsl::span<const float> times() const { return gsl::make_span(m_glTimes); }
+
+    /** When not null, the animation samples of the frames are stored here instead of on the heap */
+    SampleStore *sampleStore() const { return m_sampleStore; }
+
     GLTF::Accessor *glInputs() const;
 
     GLTF::Accessor *glInput0() const;
 
+    /** The input accessor for keys at the given times, shared with all other samplers that use the same times */
+    GLTF::Accessor *glKeyInputs(const std::string &accessorName, gsl::span<const float> keyTimes) const;
+
   private:
+    TimeAccessorPool &m_timeAccessors;
+    SampleStore *m_sampleStore;
+
     const std::string m_accessorName;
 
     // For each animation frame, the clip-relative time in seconds.
     std::vector<float> m_glTimes;
 
-    mutable std::unique_ptr<GLTF::Accessor> m_glInputs;
-    mutable std::unique_ptr<GLTF::Accessor> m_glInput0;
+    mutable GLTF::Accessor *m_glInputs = nullptr;
+    mutable GLTF::Accessor *m_glInput0 = nullptr;
 
     DISALLOW_COPY_MOVE_ASSIGN(ExportableFrames);
 };
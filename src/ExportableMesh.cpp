@@ -10,16 +10,41 @@
 #include "GLTFTargetNames.h"
 #include "MayaException.h"
 #include "Mesh.h"
+#include "MeshBlendShapeWeights.h"
+#include "MeshBounds.h"
 #include "MeshSkeleton.h"
 #include "accessors.h"
 
+namespace {
+// Destructs the data handle of a plug, also when reading from it fails.
+class PlugDataHandle {
+  public:
+    PlugDataHandle(const MPlug &plug, MDataHandle handle) : m_plug(plug), m_handle(handle) {}
+    ~PlugDataHandle() { m_plug.destructHandle(m_handle); }
+
+    MDataHandle &handle() { return m_handle; }
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(PlugDataHandle);
+
+    const MPlug &m_plug;
+    MDataHandle m_handle;
+};
+} // namespace
+
 ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, const MDagPath &shapeDagPath)
-    : ExportableObject(shapeDagPath.node()) {
+    : ExportableObject(shapeDagPath.node()), m_shapeDagPath(shapeDagPath) {
     MStatus status;
 
     auto &resources = scene.resources();
     auto &args = resources.arguments();
 
+    if (args.isAnimationOnly()) {
+        // The geometry is reused from the animation base asset, only the blend shape weights are needed.
+        loadBlendShapeWeights(args);
+        return;
+    }
+
     const auto mayaMesh = std::make_unique<Mesh>(scene, shapeDagPath, node);
 
     if (args.dumpMaya) {
@@ -57,6 +82,11 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
 
         const auto &vertexBufferEntries = renderables.table();
         const size_t vertexBufferCount = vertexBufferEntries.size();
+
+        // Only deformed meshes need vertex animation textures
+        const bool hasVertexAnimation = args.vertexAnimationFormat != VertexAnimationFormat::None &&
+                                        !args.animationClips.empty() &&
+                                        (!mainShape.skeleton().isEmpty() || mayaMesh->allShapes().size() > 1);
         {
             size_t vertexBufferIndex = 0;
             for (auto &&pair : vertexBufferEntries) {
@@ -90,6 +120,11 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
 
                     m_primitives.emplace_back(std::move(exportablePrimitive));
 
+                    if (hasVertexAnimation) {
+                        m_vertexAnimationSources.push_back(
+                            {glMesh.primitives.size() - 1, vertexBuffer.pointIndices, vertexBuffer.normalIndices});
+                    }
+
                     if (args.debugTangentVectors) {
                         auto debugPrimitive = std::make_unique<ExportablePrimitive>(
                             primitiveName, vertexBuffer, resources, Semantic::Kind::TANGENT, ShapeIndex::main(),
@@ -123,6 +158,9 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
                                                     : std::string(weightArrays[1].asChar()));
                 }
             }
+
+            groupWeightArrays();
+
             if (!mayaMesh->allShapes().empty()) {
                 glMesh.extras.insert({"targetNames", static_cast<GLTF::Object *>(m_morphTargetNames.get())});
             }
@@ -130,7 +168,30 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
 
         // Generate skin
         auto &skeleton = mainShape.skeleton();
-        if (!skeleton.isEmpty()) {
+
+        if (args.clipBounds && !args.animationClips.empty() && (!skeleton.isEmpty() || !m_weightPlugs.empty())) {
+            m_bounds = std::make_unique<MeshBounds>(mainShape, mayaMesh->allShapes());
+        }
+        if (skeleton.isEmpty()) {
+            // The node moves the mesh rigidly, remember how far the mesh extends from the node's origin.
+            MFnMesh fnMesh(shapeDagPath, &status);
+            THROW_ON_FAILURE(status);
+
+            const auto box = fnMesh.boundingBox(&status);
+            THROW_ON_FAILURE(status);
+
+            const auto shapeMatrix = shapeDagPath.inclusiveMatrix(&status);
+            THROW_ON_FAILURE(status);
+
+            const auto nodeOrigin = MPoint::origin * node.dagPath.inclusiveMatrix();
+            const auto &min = box.min();
+            const auto &max = box.max();
+
+            for (int corner = 0; corner < 8; ++corner) {
+                const MPoint point(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+                node.influenceRadius = std::max(node.influenceRadius, (point * shapeMatrix).distanceTo(nodeOrigin));
+            }
+        } else {
             args.assignName(glSkin, shapeDagPath, "");
 
             auto &joints = skeleton.joints();
@@ -144,6 +205,8 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
                 auto *jointNode = joint.node;
                 glSkin.joints.emplace_back(const_cast<GLTF::Node *>(&jointNode->glPrimaryNode()));
 
+                jointNode->influenceRadius = std::max(jointNode->influenceRadius, joint.influenceRadius);
+
                 // auto distanceToRoot = ExportableScene::distanceToRoot(jointNode->dagPath);
                 // distanceToRootMap[distanceToRoot].emplace_back(jointNode);
 
@@ -188,6 +251,70 @@ ExportableMesh::ExportableMesh(ExportableScene &scene, ExportableNode &node, con
 
 ExportableMesh::~ExportableMesh() = default;
 
+void ExportableMesh::loadBlendShapeWeights(const Arguments &args) {
+    MStatus status;
+
+    MFnMesh fnMesh(m_shapeDagPath, &status);
+    THROW_ON_FAILURE(status);
+
+    const auto blendShapeDeformer =
+        args.skipBlendShapes ? MObject::kNullObj : Mesh::tryExtractBlendShapeDeformer(fnMesh, args.ignoreMeshDeformers);
+
+    if (blendShapeDeformer.isNull())
+        return;
+
+    MFnBlendShapeDeformer fnBlendShapeDeformer(blendShapeDeformer, &status);
+    THROW_ON_FAILURE(status);
+
+    const MPlug weightArrayPlug = fnBlendShapeDeformer.findPlug("weight", true, &status);
+    THROW_ON_FAILURE(status);
+
+    // The weights are in the same order as the morph targets of a full export, see Mesh
+    const MeshBlendShapeWeights weightPlugs(weightArrayPlug);
+
+    for (auto &&pair : weightPlugs.entries()) {
+        const auto &entry = pair.second;
+        const auto initialWeight = static_cast<float>(entry.originalWeight);
+        m_weightPlugs.emplace_back(weightPlugs.getWeightPlug(entry));
+        m_initialWeights.emplace_back(initialWeight);
+        glMesh.weights.emplace_back(initialWeight);
+    }
+
+    groupWeightArrays();
+}
+
+void ExportableMesh::groupWeightArrays() {
+    MStatus status;
+
+    for (size_t weightIndex = 0; weightIndex < m_weightPlugs.size(); ++weightIndex) {
+        auto &plug = m_weightPlugs[weightIndex];
+
+        // A connected weight must be evaluated through its plug.
+        if (plug.isDestination(&status)) {
+            m_drivenWeightIndices.emplace_back(weightIndex);
+            continue;
+        }
+
+        THROW_ON_FAILURE(status);
+
+        const auto arrayPlug = plug.array(&status);
+        THROW_ON_FAILURE(status);
+
+        auto weightArray = std::find_if(m_weightArrays.begin(), m_weightArrays.end(),
+                                        [&arrayPlug](const WeightArray &wa) { return wa.arrayPlug == arrayPlug; });
+
+        if (weightArray == m_weightArrays.end()) {
+            m_weightArrays.emplace_back();
+            weightArray = std::prev(m_weightArrays.end());
+            weightArray->arrayPlug = arrayPlug;
+        }
+
+        weightArray->logicalIndices.emplace_back(plug.logicalIndex(&status));
+        THROW_ON_FAILURE(status);
+        weightArray->weightIndices.emplace_back(weightIndex);
+    }
+}
+
 void ExportableMesh::getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const {
     for (auto &&primitive : m_primitives) {
         primitive->getAllAccessors(accessors);
@@ -198,17 +325,50 @@ void ExportableMesh::getAllAccessors(std::vector<GLTF::Accessor *> &accessors) c
     }
 }
 
+void ExportableMesh::getVertexStreams(const VertexBufferLayout layout, std::vector<std::vector<GLTF::Accessor *>> &streams) const {
+    for (auto &&primitive : m_primitives) {
+        primitive->getVertexStreams(layout, streams);
+    }
+}
+
 std::vector<float> ExportableMesh::currentWeights() const {
-    std::vector<float> weights;
-    weights.reserve(m_weightPlugs.size());
+    std::vector<float> weights(m_weightPlugs.size());
+    readWeights(weights);
+    return weights;
+}
+
+void ExportableMesh::readWeights(gsl::span<float> weights) const {
+    assert(weights.size() == m_weightPlugs.size());
+
+    MStatus status;
 
-    for (auto &plug : m_weightPlugs) {
-        float weight;
-        THROW_ON_FAILURE(plug.getValue(weight));
-        weights.emplace_back(weight);
+    for (auto &weightArray : m_weightArrays) {
+        // Read the static weights of the whole array once, instead of each weight plug.
+        const auto handle = weightArray.arrayPlug.asMDataHandle(&status);
+        THROW_ON_FAILURE(status);
+
+        PlugDataHandle dataHandle(weightArray.arrayPlug, handle);
+
+        MArrayDataHandle arrayHandle(dataHandle.handle(), &status);
+        THROW_ON_FAILURE(status);
+
+        const auto count = weightArray.weightIndices.size();
+
+        for (size_t i = 0; i < count; ++i) {
+            const auto weightIndex = weightArray.weightIndices[i];
+
+            if (arrayHandle.jumpToElement(weightArray.logicalIndices[i])) {
+                weights[weightIndex] = arrayHandle.inputValue().asFloat();
+            } else {
+                // Sparse array element without data, fall back to the plug.
+                THROW_ON_FAILURE(m_weightPlugs[weightIndex].getValue(weights[weightIndex]));
+            }
+        }
     }
 
-    return weights;
+    for (const auto weightIndex : m_drivenWeightIndices) {
+        THROW_ON_FAILURE(m_weightPlugs[weightIndex].getValue(weights[weightIndex]));
+    }
 }
 
 void ExportableMesh::attachToNode(GLTF::Node &node) {
@@ -220,9 +380,5 @@ void ExportableMesh::attachToNode(GLTF::Node &node) {
 }
 
 void ExportableMesh::updateWeights() {
-    for (size_t i = 0; i < m_weightPlugs.size(); ++i) {
-        auto &plug = m_weightPlugs.at(i);
-        auto &weight = glMesh.weights.at(i);
-        THROW_ON_FAILURE(plug.getValue(weight));
-    }
+    readWeights(gsl::make_span(glMesh.weights));
 }
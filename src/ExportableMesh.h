@@ -2,12 +2,14 @@
 
 #include "ExportableObject.h"
 #include "BasicTypes.h"
+#include "sceneTypes.h"
 
 class ExportableResources;
 class ExportablePrimitive;
 class Arguments;
 class ExportableScene;
 class ExportableNode;
+class MeshBounds;
 
 class ExportableMesh : public ExportableObject {
   public:
@@ -28,21 +30,64 @@ class ExportableMesh : public ExportableObject {
 
     std::vector<float> currentWeights() const;
 
+    // Reads the current weights of all blend shapes, without allocating.
+    void readWeights(gsl::span<float> weights) const;
+
     void attachToNode(GLTF::Node &node);
 
     void updateWeights();
 
     void getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const;
 
+    void getVertexStreams(VertexBufferLayout layout, std::vector<std::vector<GLTF::Accessor *>> &streams) const;
+
+    // The bounds of a skinned or morphed mesh, only computed when exporting clip bounds, otherwise null.
+    const MeshBounds *bounds() const { return m_bounds.get(); }
+
+    // For a primitive of a skinned or morphed mesh, the Maya point and normal of each vertex, to sample vertex animation textures.
+    struct VertexAnimationSource {
+        size_t primitiveIndex;
+        IndexVector pointIndices;
+        IndexVector normalIndices;
+    };
+
+    // Only filled when exporting vertex animation textures.
+    const std::vector<VertexAnimationSource> &vertexAnimationSources() const { return m_vertexAnimationSources; }
+
+    const MDagPath &shapeDagPath() const { return m_shapeDagPath; }
+
   private:
     DISALLOW_COPY_MOVE_ASSIGN(ExportableMesh);
 
     std::vector<float> m_initialWeights;
     std::vector<MPlug> m_weightPlugs;
+
+    // The weight plugs grouped per blend shape deformer, so all weights of a deformer are read at once.
+    struct WeightArray {
+        MPlug arrayPlug;
+        std::vector<unsigned> logicalIndices;
+        std::vector<size_t> weightIndices;
+    };
+
+    std::vector<WeightArray> m_weightArrays;
+
+    // Weights driven by a connection, the data handle of the array might hold a stale value for these.
+    // These are evaluated one plug at a time, no API evaluates the connected elements of an array at once.
+    std::vector<size_t> m_drivenWeightIndices;
     std::vector<std::unique_ptr<ExportablePrimitive>> m_primitives;
 
+    std::unique_ptr<MeshBounds> m_bounds;
+
+    MDagPath m_shapeDagPath;
+    std::vector<VertexAnimationSource> m_vertexAnimationSources;
+
     std::vector<Float4x4> m_inverseBindMatrices;
     std::unique_ptr<GLTF::Accessor> m_inverseBindMatricesAccessor;
     std::unique_ptr<GLTF::MorphTargetNames> m_morphTargetNames =
         std::make_unique<GLTF::MorphTargetNames>();
+
+    // Only finds the blend shape weight plugs, for animation-only exports
+    void loadBlendShapeWeights(const Arguments &args);
+
+    void groupWeightArrays();
 };
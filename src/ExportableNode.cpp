@@ -27,6 +27,11 @@ void ExportableNode::load(ExportableScene &scene, NodeTransformCache &transformC
     dirPrecision = args.dirPrecision;
     sclPrecision = args.sclPrecision;
 
+    // Remember the animation tolerances, these might be refined by ExportableScene::computeAnimationTolerances
+    constantThresholds = ChannelTolerances(args.constantTranslationThreshold, args.constantRotationThreshold, args.constantScalingThreshold,
+                                           args.constantWeightsThreshold);
+    keyframeTolerances = ChannelTolerances::uniform(args.keyframeTolerance);
+
     // // Get name
     // const auto name = dagPath.partialPathName(&status);
     // THROW_ON_FAILURE(status);
@@ -34,6 +39,22 @@ void ExportableNode::load(ExportableScene &scene, NodeTransformCache &transformC
     // Get parent
     parentNode = scene.getParent(this);
 
+    // The parent is loaded now, so it already got a lower index
+    index = scene.m_nodeIndexCount++;
+
+    bool inheritsTransform = true;
+    DagHelper::getPlugValue(obj, "inheritsTransform", inheritsTransform);
+
+    MDagPath dagParentPath = dagPath;
+    dagParentPath.pop();
+
+    hasDagParentTransform = inheritsTransform && (parentNode ? parentNode->dagPath == dagParentPath : dagParentPath.length() == 0);
+
+    if (hasDagParentTransform) {
+        localMatrixPlug = MFnDagNode(dagPath).findPlug("matrix", true, &status);
+        hasDagParentTransform = status && !localMatrixPlug.isNull();
+    }
+
     // Deal with segment scale compensation
     // A root joint never has segment scale compensation, since the parent is
     // the world.
@@ -208,6 +229,8 @@ bool ExportableNode::tryMergeRedundantShapeNode() {
     cout << prefix << "Shape-only node '" << name() << "' is redundant, moving its shapes to parent node '"
          << parentNode->name() << "'" << endl;
 
+    parentNode->influenceRadius = std::max(parentNode->influenceRadius, influenceRadius);
+
     glParentNode.children.clear();
     glNode.mesh = nullptr;
     glNode.skin = nullptr;
@@ -231,3 +254,9 @@ void ExportableNode::getAllAccessors(std::vector<GLTF::Accessor *> &accessors) c
         m_mesh->getAllAccessors(accessors);
     }
 }
+
+void ExportableNode::getVertexStreams(const VertexBufferLayout layout, std::vector<std::vector<GLTF::Accessor *>> &streams) const {
+    if (m_mesh) {
+        m_mesh->getVertexStreams(layout, streams);
+    }
+}
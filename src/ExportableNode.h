@@ -1,5 +1,6 @@
 #pragma once
 
+#include "AnimationTolerances.h"
 #include "ExportableCamera.h"
 #include "ExportableMesh.h"
 #include "ExportableObject.h"
@@ -40,9 +41,30 @@ class ExportableNode : public ExportableObject {
 
     MPoint pivotPoint;
 
+    // The radius around the node's origin of the geometry it moves (rigidly or by skinning), in Maya world units
+    double influenceRadius = 0;
+
+    // Below these deviations an animation channel is considered constant
+    ChannelTolerances constantThresholds;
+
+    // The maximum deviation of the reduced keyframes from the sampled frames
+    ChannelTolerances keyframeTolerances;
+
     // nullptr for root nodes.
     ExportableNode *parentNode = nullptr;
 
+    // Is the parent node the DAG parent of this node, and does this node inherit its transform?
+    // If so, the Maya local matrix of this node is relative to the parent node.
+    // This is not the case for logical parents.
+    bool hasDagParentTransform = false;
+
+    // The Maya local matrix of this node, only used when hasDagParentTransform is set
+    MPlug localMatrixPlug;
+
+    // Dense index of the node in the scene, used to index flat per-node tables.
+    // A parent node always has a lower index than its children.
+    size_t index = 0;
+
     NodeTransformState initialTransformState;
     NodeTransformState currentTransformState;
 
@@ -71,6 +93,8 @@ class ExportableNode : public ExportableObject {
 
     void getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const;
 
+    void getVertexStreams(VertexBufferLayout layout, std::vector<std::vector<GLTF::Accessor *>> &streams) const;
+
   private:
     friend class ExportableScene;
 
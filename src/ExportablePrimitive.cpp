@@ -212,3 +212,24 @@ void ExportablePrimitive::getAllAccessors(
         accessors.emplace_back(accessor.get());
     }
 }
+
+void ExportablePrimitive::getVertexStreams(
+    const VertexBufferLayout layout,
+    std::vector<std::vector<GLTF::Accessor *>> &streams) const {
+    if (layout == VertexBufferLayout::Planar)
+        return;
+
+    std::vector<GLTF::Accessor *> stream;
+
+    for (auto &&pair : glPrimitive.attributes) {
+        if (layout == VertexBufferLayout::PositionSplit &&
+            pair.first == glTFattributeName(Semantic::Kind::POSITION, 0))
+            continue;
+
+        stream.emplace_back(pair.second);
+    }
+
+    if (stream.size() > 1) {
+        streams.emplace_back(std::move(stream));
+    }
+}
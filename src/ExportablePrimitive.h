@@ -32,6 +32,11 @@ class ExportablePrimitive {
 
     void getAllAccessors(std::vector<GLTF::Accessor *> &accessors) const;
 
+    // Adds the vertex attribute accessors to interleave for the layout.
+    void
+    getVertexStreams(VertexBufferLayout layout,
+                     std::vector<std::vector<GLTF::Accessor *>> &streams) const;
+
   private:
     std::vector<std::unique_ptr<GLTF::Accessor>> glAccessors;
 
@@ -9,6 +9,8 @@ ExportableScene::ExportableScene(ExportableResources &resources) : m_resources(r
 ExportableScene::~ExportableScene() = default;
 
 void ExportableScene::updateCurrentValues() {
+    m_currentTransformCache.reset();
+
     for (auto &&pair : m_table) {
         auto &node = pair.second;
         node->updateNodeTransforms(m_currentTransformCache);
@@ -34,6 +36,84 @@ void ExportableScene::mergeRedundantShapeNodes() {
     }
 }
 
+static double maxAxisLength(const MMatrix &m) {
+    double maxLengthSquared = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const auto lengthSquared = m[axis][0] * m[axis][0] + m[axis][1] * m[axis][1] + m[axis][2] * m[axis][2];
+        maxLengthSquared = std::max(maxLengthSquared, lengthSquared);
+    }
+    return std::sqrt(maxLengthSquared);
+}
+
+void ExportableScene::computeAnimationTolerances() {
+    const auto &args = arguments();
+
+    const auto tolerance = args.worldErrorTolerance;
+    if (tolerance <= 0)
+        return;
+
+    MStatus status;
+
+    // The world position of each node's origin
+    std::unordered_map<const ExportableNode *, MPoint> origins;
+    for (auto &&pair : m_table) {
+        auto &node = pair.second;
+        const auto worldMatrix = node->dagPath.inclusiveMatrix(&status);
+        THROW_ON_FAILURE(status);
+        origins[node.get()] = MPoint::origin * worldMatrix;
+    }
+
+    // The reach of a node is the largest distance from its origin to any geometry or descendant node it moves.
+    // Rotating the node by a small angle displaces the geometry by at most angle * reach.
+    std::unordered_map<const ExportableNode *, double> reaches;
+    for (auto &&pair : m_table) {
+        const auto *node = pair.second.get();
+        const auto &origin = origins.at(node);
+
+        for (auto *ancestor = node; ancestor; ancestor = ancestor->parentNode) {
+            auto &reach = reaches[ancestor];
+            reach = std::max(reach, origin.distanceTo(origins.at(ancestor)) + node->influenceRadius);
+        }
+    }
+
+    // Errors are measured in glTF world units
+    const auto worldScaleFactor = args.globalScaleFactor;
+    const auto rootScaleFactor = args.getRootScaleFactor();
+
+    for (auto &&pair : m_table) {
+        auto &node = pair.second;
+
+        // A local translation error is scaled by the parent's world transform.
+        double parentScaleFactor = 1;
+        if (node->parentNode) {
+            const auto parentMatrix = node->parentNode->dagPath.inclusiveMatrix(&status);
+            THROW_ON_FAILURE(status);
+            parentScaleFactor = maxAxisLength(parentMatrix);
+        }
+
+        if (parentScaleFactor > 0) {
+            const auto translationTolerance = tolerance / (rootScaleFactor * parentScaleFactor);
+            node->constantThresholds.translation = translationTolerance;
+            node->keyframeTolerances.translation = translationTolerance;
+        }
+
+        // Nodes that don't move any geometry (e.g. locators) keep the regular thresholds,
+        // as do cameras, since their rotation changes the whole view.
+        const auto reach = reaches[node.get()] * worldScaleFactor;
+        if (reach > 0 && !node->camera()) {
+            // A change of a quaternion component by e rotates by about 2e radians.
+            const auto rotationTolerance = tolerance / (2 * reach);
+            const auto scalingTolerance = tolerance / reach;
+            node->constantThresholds.rotation = rotationTolerance;
+            node->keyframeTolerances.rotation = rotationTolerance;
+            node->constantThresholds.scaling = scalingTolerance;
+            node->keyframeTolerances.scaling = scalingTolerance;
+        }
+    }
+
+    cout << prefix << "Derived animation tolerances of " << m_table.size() << " nodes from world error tolerance " << tolerance << endl;
+}
+
 ExportableNode *ExportableScene::getNode(const MDagPath &dagPath) {
     MStatus status;
 
@@ -87,6 +167,12 @@ void ExportableScene::getAllAccessors(AccessorsPerDagPath &accessors) {
     }
 }
 
+void ExportableScene::getVertexStreams(const VertexBufferLayout layout, std::vector<std::vector<GLTF::Accessor *>> &streams) {
+    for (auto &&pair : m_table) {
+        pair.second->getVertexStreams(layout, streams);
+    }
+}
+
 void ExportableScene::registerOrphanNode(ExportableNode *node) { m_orphans[node->dagPath] = node; }
 
 // int ExportableScene::distanceToRoot(MDagPath dagPath) {
@@ -31,6 +31,11 @@ class ExportableScene {
 
     void mergeRedundantShapeNodes();
 
+    // Derive the animation tolerances of each node from the world error tolerance,
+    // by propagating the local errors to the world displacement of all geometry the node moves.
+    // Must be called at the initial values time.
+    void computeAnimationTolerances();
+
     // Gets or creates the node
     // Returns null if the DAG path has no node
     ExportableNode *getNode(const MDagPath &dagPath);
@@ -41,6 +46,9 @@ class ExportableScene {
 
     void getAllAccessors(AccessorsPerDagPath &accessors);
 
+    // The vertex attribute accessors to interleave per primitive, for the layout.
+    void getVertexStreams(VertexBufferLayout layout, std::vector<std::vector<GLTF::Accessor *>> &streams);
+
     // Register a node without parent
     void registerOrphanNode(ExportableNode *node);
 
@@ -48,6 +56,9 @@ class ExportableScene {
 
     const NodeTable &table() const { return m_table; }
 
+    // The number of node indices handed out, see ExportableNode::index
+    size_t nodeIndexCount() const { return m_nodeIndexCount; }
+
     GLTF::Scene glScene;
 
   private:
@@ -59,6 +70,7 @@ class ExportableScene {
 
     ExportableResources &m_resources;
     NodeTable m_table;
+    size_t m_nodeIndexCount = 0;
     NodeTransformCache m_initialTransformCache;
     NodeTransformCache m_currentTransformCache;
     OrphanNodes m_orphans;
@@ -0,0 +1,182 @@
+#include "externals.h"
+
+#include "GlbWriter.h"
+#include "IndentableStream.h"
+#include "filesystem.h"
+#include "outputFiles.h"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const uint32_t glbMagic = 0x46546C67; // "glTF"
+const uint32_t glbVersion = 2;
+const uint32_t glbJsonChunkType = 0x4E4F534A;
+const uint32_t glbBinaryChunkType = 0x004E4942;
+
+const char jsonPadding[4] = {' ', ' ', ' ', ' '};
+const char zeroPadding[4096] = {};
+} // namespace
+
+void GlbWriter::addBinary(const size_t byteOffset, const void *data, const size_t byteLength) {
+    assert(byteOffset >= m_binaryLength);
+
+    if (byteLength) {
+        m_segments.push_back({byteOffset, {data, byteLength}});
+    }
+
+    m_binaryLength = byteOffset + byteLength;
+}
+
+void GlbWriter::prependBinary(const size_t byteOffset, const void *data, const size_t byteLength) {
+    assert(byteLength <= byteOffset);
+
+    for (auto &segment : m_segments) {
+        segment.byteOffset += byteOffset;
+    }
+
+    if (byteLength) {
+        m_segments.insert(m_segments.begin(), {0, {data, byteLength}});
+    }
+
+    m_binaryLength = std::max(m_binaryLength + byteOffset, byteLength);
+}
+
+void GlbWriter::write(const std::string &path, const std::string &json, const bool skipUnchanged) const {
+    const size_t headerLength = 12;
+    const size_t chunkHeaderLength = 8;
+
+    const auto jsonLength = json.size();
+    const auto jsonPaddingLength = (4 - (jsonLength & 3)) & 3;
+    const auto binaryPaddingLength = (4 - (m_binaryLength & 3)) & 3;
+
+    const auto jsonChunkLength = jsonLength + jsonPaddingLength;
+    const auto binaryChunkLength = m_binaryLength + binaryPaddingLength;
+
+    const auto fileLength = headerLength + chunkHeaderLength + jsonChunkLength + (m_binaryLength ? chunkHeaderLength + binaryChunkLength : 0);
+
+    if (fileLength > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Can't write '" + path + "', a GLB file can't be larger than 4GB");
+
+    const uint32_t header[5] = {glbMagic, glbVersion, static_cast<uint32_t>(fileLength), static_cast<uint32_t>(jsonChunkLength),
+                                glbJsonChunkType};
+    const uint32_t binaryHeader[2] = {static_cast<uint32_t>(binaryChunkLength), glbBinaryChunkType};
+
+    std::vector<Range> ranges;
+    ranges.reserve(4 + m_segments.size() * 2);
+
+    ranges.push_back({header, sizeof header});
+    ranges.push_back({json.data(), jsonLength});
+    ranges.push_back({jsonPadding, jsonPaddingLength});
+
+    const auto addZeros = [&ranges](size_t byteLength) {
+        for (; byteLength > 0; byteLength -= std::min(byteLength, sizeof zeroPadding)) {
+            ranges.push_back({zeroPadding, std::min(byteLength, sizeof zeroPadding)});
+        }
+    };
+
+    if (m_binaryLength) {
+        ranges.push_back({binaryHeader, sizeof binaryHeader});
+
+        size_t byteOffset = 0;
+
+        for (auto &segment : m_segments) {
+            addZeros(segment.byteOffset - byteOffset);
+            ranges.push_back(segment.range);
+            byteOffset = segment.byteOffset + segment.range.byteLength;
+        }
+
+        addZeros(binaryChunkLength - byteOffset);
+    }
+
+    if (!skipUnchanged) {
+        writeRanges(path, ranges);
+        return;
+    }
+
+    FileContent content;
+    content.reserve(ranges.size());
+
+    for (auto &range : ranges) {
+        const auto data = static_cast<const uint8_t *>(range.data);
+        content.push_back(gsl::make_span(data, data + range.byteLength));
+    }
+
+    if (hasFileContent(path, content)) {
+        cout << prefix << "Skipped unchanged '" << path << "'" << endl;
+        return;
+    }
+
+    const auto tempPath = temporaryFilePath(path);
+    writeRanges(tempPath, ranges);
+    fs::rename(tempPath, path);
+}
+
+#ifdef _MSC_VER
+
+void GlbWriter::writeRanges(const std::string &path, const std::vector<Range> &ranges) {
+    // No vectored I/O for regular files on Windows, but still no copies.
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Couldn't write to '" + path + "'");
+
+    for (auto &range : ranges) {
+        file.write(static_cast<const char *>(range.data), range.byteLength);
+    }
+
+    if (!file)
+        throw std::runtime_error("Failed to write '" + path + "'");
+}
+
+#else
+
+void GlbWriter::writeRanges(const std::string &path, const std::vector<Range> &ranges) {
+    const auto fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+        throw std::runtime_error("Couldn't write to '" + path + "'");
+
+    std::vector<iovec> vectors;
+    vectors.reserve(ranges.size());
+
+    for (auto &range : ranges) {
+        if (range.byteLength) {
+            vectors.push_back({const_cast<void *>(range.data), range.byteLength});
+        }
+    }
+
+    size_t index = 0;
+
+    while (index < vectors.size()) {
+        const auto count = std::min(vectors.size() - index, static_cast<size_t>(IOV_MAX));
+        const auto written = writev(fd, &vectors[index], static_cast<int>(count));
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+
+            close(fd);
+            throw std::runtime_error("Failed to write '" + path + "'");
+        }
+
+        // Skip the written ranges, and continue a partially written one.
+        auto remaining = static_cast<size_t>(written);
+
+        while (index < vectors.size() && remaining >= vectors[index].iov_len) {
+            remaining -= vectors[index].iov_len;
+            ++index;
+        }
+
+        if (remaining) {
+            vectors[index].iov_base = static_cast<char *>(vectors[index].iov_base) + remaining;
+            vectors[index].iov_len -= remaining;
+        }
+    }
+
+    if (close(fd) != 0)
+        throw std::runtime_error("Failed to write '" + path + "'");
+}
+
+#endif
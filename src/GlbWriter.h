@@ -0,0 +1,48 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * Writes a GLB file straight from the memory of the JSON, the accessors and the images,
+ * without first assembling the binary chunk in a single buffer.
+ *
+ * The binary chunk is described by byte ranges at increasing offsets, the gaps between them are zero padding.
+ * On POSIX systems the whole file is written with vectored I/O.
+ */
+class GlbWriter {
+  public:
+    GlbWriter() = default;
+    ~GlbWriter() = default;
+
+    /** Places bytes in the binary chunk, after all bytes placed before. The memory must stay valid until the file is written */
+    void addBinary(size_t byteOffset, const void *data, size_t byteLength);
+
+    /** Moves all placed bytes forward by byteOffset, and places the given bytes before them */
+    void prependBinary(size_t byteOffset, const void *data, size_t byteLength);
+
+    /** Extends the binary chunk with zeros up to the given length */
+    void reserveBinary(size_t byteLength) { m_binaryLength = std::max(m_binaryLength, byteLength); }
+
+    size_t binaryLength() const { return m_binaryLength; }
+
+    /** When skipping an unchanged file, a file that already has this content is not touched, otherwise it is replaced atomically */
+    void write(const std::string &path, const std::string &json, bool skipUnchanged = false) const;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(GlbWriter);
+
+    struct Range {
+        const void *data;
+        size_t byteLength;
+    };
+
+    struct Segment {
+        size_t byteOffset;
+        Range range;
+    };
+
+    std::vector<Segment> m_segments;
+    size_t m_binaryLength = 0;
+
+    static void writeRanges(const std::string &path, const std::vector<Range> &ranges);
+};
@@ -0,0 +1,152 @@
+#include "externals.h"
+
+#include "IndentableStream.h"
+#include "MappedOutputFile.h"
+#include "filesystem.h"
+#include "outputFiles.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedOutputFile::~MappedOutputFile() {
+    close();
+
+    // Not committed
+    if (!m_path.empty()) {
+        std::error_code errorCode;
+        fs::remove(m_path, errorCode);
+    }
+}
+
+#ifdef _MSC_VER
+
+std::unique_ptr<MappedOutputFile> MappedOutputFile::tryCreate(const std::string &folder, const size_t byteLength) {
+    std::unique_ptr<MappedOutputFile> file(new MappedOutputFile());
+
+    char path[MAX_PATH];
+    if (!GetTempFileNameA(folder.c_str(), "m2g", 0, path)) {
+        cerr << prefix << "WARNING: failed to create a mapped output file in " << folder << ", writing from memory instead" << endl;
+        return nullptr;
+    }
+
+    file->m_path = path;
+
+    file->m_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file->m_file == INVALID_HANDLE_VALUE) {
+        file->m_file = nullptr;
+        cerr << prefix << "WARNING: failed to open mapped output file " << path << ", writing from memory instead" << endl;
+        return nullptr;
+    }
+
+    // Mapping beyond the end of the file grows it, with zeros.
+    file->m_mapping = CreateFileMappingA(file->m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(uint64_t(byteLength) >> 32),
+                                         static_cast<DWORD>(byteLength), nullptr);
+
+    file->m_data = file->m_mapping ? MapViewOfFile(file->m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, byteLength) : nullptr;
+
+    if (!file->m_data) {
+        cerr << prefix << "WARNING: failed to map output file " << path << ", writing from memory instead" << endl;
+        return nullptr;
+    }
+
+    file->m_byteLength = byteLength;
+
+    return file;
+}
+
+bool MappedOutputFile::close() {
+    bool flushed = true;
+
+    if (m_data) {
+        flushed = FlushViewOfFile(m_data, 0) && flushed;
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+
+    if (m_file) {
+        flushed = FlushFileBuffers(m_file) && flushed;
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+
+    return flushed;
+}
+
+#else
+
+std::unique_ptr<MappedOutputFile> MappedOutputFile::tryCreate(const std::string &folder, const size_t byteLength) {
+    std::unique_ptr<MappedOutputFile> file(new MappedOutputFile());
+
+    file->m_path = (fs::path(folder) / "maya2glTF-XXXXXX").string();
+
+    file->m_file = mkstemp(&file->m_path[0]);
+    if (file->m_file < 0) {
+        cerr << prefix << "WARNING: failed to create a mapped output file in " << folder << ", writing from memory instead" << endl;
+        return nullptr;
+    }
+
+    // mkstemp creates the file only readable by the owner.
+    fchmod(file->m_file, 0644);
+
+    // Presize the file, the new bytes are zeros.
+    if (ftruncate(file->m_file, static_cast<off_t>(byteLength)) != 0) {
+        cerr << prefix << "WARNING: failed to presize mapped output file " << file->m_path << ", writing from memory instead" << endl;
+        return nullptr;
+    }
+
+    const auto data = mmap(nullptr, byteLength, PROT_READ | PROT_WRITE, MAP_SHARED, file->m_file, 0);
+    if (data == MAP_FAILED) {
+        cerr << prefix << "WARNING: failed to map output file " << file->m_path << ", writing from memory instead" << endl;
+        return nullptr;
+    }
+
+    file->m_data = data;
+    file->m_byteLength = byteLength;
+
+    return file;
+}
+
+bool MappedOutputFile::close() {
+    bool flushed = true;
+
+    if (m_data) {
+        flushed = msync(m_data, m_byteLength, MS_SYNC) == 0;
+        munmap(m_data, m_byteLength);
+        m_data = nullptr;
+    }
+
+    if (m_file >= 0) {
+        flushed = ::close(m_file) == 0 && flushed;
+        m_file = -1;
+    }
+
+    return flushed;
+}
+
+#endif
+
+bool MappedOutputFile::commit(const std::string &path, const bool skipUnchanged) {
+    // The temporary file is deleted when this is destroyed
+    if (skipUnchanged && hasFileContent(path, {gsl::make_span(data(), data() + m_byteLength)}))
+        return false;
+
+    if (!close())
+        throw std::runtime_error("Failed to write '" + path + "'");
+
+    fs::rename(m_path, path);
+
+    m_path.clear();
+    return true;
+}
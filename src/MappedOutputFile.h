@@ -0,0 +1,46 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * An output file that is presized and mapped into memory, so its content can be written in place.
+ *
+ * The file is created under a temporary name in the output folder, and only moved to its final path when committed,
+ * since the final name of a buffer might depend on its content. When not committed, the file is deleted.
+ */
+class MappedOutputFile {
+  public:
+    ~MappedOutputFile();
+
+    /** Creates a zero filled file of the given length in the folder. Returns null when the file can't be mapped */
+    static std::unique_ptr<MappedOutputFile> tryCreate(const std::string &folder, size_t byteLength);
+
+    uint8_t *data() const { return static_cast<uint8_t *>(m_data); }
+
+    size_t byteLength() const { return m_byteLength; }
+
+    /**
+     * Flushes the mapping to disk, unmaps it, and moves the file to the given path.
+     * When skipping unchanged files and the file at the path already has this content, it is kept, and false is returned.
+     */
+    bool commit(const std::string &path, bool skipUnchanged = false);
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(MappedOutputFile);
+
+    MappedOutputFile() = default;
+
+    std::string m_path;
+    void *m_data = nullptr;
+    size_t m_byteLength = 0;
+
+#ifdef _MSC_VER
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+
+    // Unmaps and closes the file, returns false when flushing failed
+    bool close();
+};
@@ -19,6 +19,12 @@ class Mesh {
     const MainShape &shape() const { return *m_mainShape; }
     const MeshShapes &allShapes() const { return m_allShapes; }
 
+    // Finds the blend shape deformer of the mesh, or returns a null object.
+    // When there are many, picks the one with most animated weights.
+    static MObject
+    tryExtractBlendShapeDeformer(const MFnMesh &fnMesh,
+                                 const MSelectionList &ignoredDeformers);
+
   private:
     DISALLOW_COPY_MOVE_ASSIGN(Mesh);
 
@@ -35,8 +41,4 @@ class Mesh {
 
     MObject getOrCreateOutputShape(MPlug &outputGeometryPlug,
                                    MObject &createdMesh) const;
-
-    static MObject
-    tryExtractBlendShapeDeformer(const MFnMesh &fnMesh,
-                                 const MSelectionList &ignoredDeformers);
 };
@@ -0,0 +1,124 @@
+#include "externals.h"
+
+#include "Arguments.h"
+#include "ExportableNode.h"
+#include "MeshBounds.h"
+#include "MeshSkeleton.h"
+
+static MPoint pointAt(const gsl::span<const float> &positions, const size_t pointIndex) {
+    const auto *p = &positions[pointIndex * 3];
+    return MPoint(p[0], p[1], p[2]);
+}
+
+MeshBounds::MeshBounds(const MainShape &mainShape, const MeshShapes &allShapes) {
+    const auto positions = mainShape.vertices().vertexElementComponentsAt(Semantic::POSITION, 0).floats();
+    const auto pointCount = static_cast<size_t>(positions.size()) / 3;
+
+    for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex) {
+        const auto point = pointAt(positions, pointIndex);
+        if (pointIndex == 0) {
+            m_meshBox = MBoundingBox(point, point);
+        } else {
+            m_meshBox.expand(point);
+        }
+    }
+
+    const auto &skeleton = mainShape.skeleton();
+
+    if (!skeleton.isEmpty()) {
+        const auto &joints = skeleton.joints();
+
+        m_joints.reserve(joints.size());
+
+        for (auto &joint : joints) {
+            m_joints.push_back({joint.node, joint.inverseBindMatrix, MBoundingBox(), false});
+        }
+
+        const auto &assignmentsPerPoint = skeleton.vertexJointAssignments();
+        const auto assignedPointCount = std::min(pointCount, assignmentsPerPoint.size());
+
+        for (size_t pointIndex = 0; pointIndex < assignedPointCount; ++pointIndex) {
+            const auto point = pointAt(positions, pointIndex);
+
+            for (auto &assignment : assignmentsPerPoint[pointIndex]) {
+                auto &joint = m_joints[assignment.jointIndex];
+                if (joint.hasVertices) {
+                    joint.box.expand(point);
+                } else {
+                    joint.box = MBoundingBox(point, point);
+                    joint.hasVertices = true;
+                }
+            }
+        }
+    }
+
+    for (auto *shape : allShapes) {
+        if (!shape->shapeIndex.isBlendShapeIndex())
+            continue;
+
+        const auto targetPositions = shape->vertices().vertexElementComponentsAt(Semantic::POSITION, 0).floats();
+        const auto targetPointCount = std::min(pointCount, static_cast<size_t>(targetPositions.size()) / 3);
+
+        MBoundingBox offsetBox(MPoint::origin, MPoint::origin);
+
+        for (size_t pointIndex = 0; pointIndex < targetPointCount; ++pointIndex) {
+            const auto offset = pointAt(targetPositions, pointIndex) - pointAt(positions, pointIndex);
+            offsetBox.expand(MPoint(offset));
+        }
+
+        m_offsetBoxes.emplace_back(offsetBox);
+    }
+}
+
+MeshBounds::~MeshBounds() = default;
+
+void MeshBounds::expand(NodeTransformCache &transformCache, const ExportableNode &meshNode, const gsl::span<const float> weights,
+                        const Arguments &args, MBoundingBox &bounds, bool &isEmpty) const {
+    assert(weights.size() == m_offsetBoxes.size());
+
+    // The range of the blend shape offsets that are added to each vertex.
+    MVector offsetMin;
+    MVector offsetMax;
+
+    for (size_t index = 0; index < m_offsetBoxes.size(); ++index) {
+        const double weight = weights[index];
+        const auto &box = m_offsetBoxes[index];
+        const auto a = MVector(box.min()) * weight;
+        const auto b = MVector(box.max()) * weight;
+        offsetMin += MVector(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+        offsetMax += MVector(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+    }
+
+    const auto scaleFactor = args.getBakeScaleFactor();
+
+    // Maya world matrices don't include the bake scale factor, the exported translations do.
+    const auto worldMatrix = [&](const ExportableNode *node) {
+        auto matrix = transformCache.getTransform(node, scaleFactor, args.posPrecision, args.sclPrecision, args.dirPrecision).worldMatrix;
+        matrix[3][0] *= scaleFactor;
+        matrix[3][1] *= scaleFactor;
+        matrix[3][2] *= scaleFactor;
+        return matrix;
+    };
+
+    const auto expandBy = [&](const MBoundingBox &meshBox, const MMatrix &matrix) {
+        MBoundingBox box(meshBox.min() + offsetMin, meshBox.max() + offsetMax);
+        box.transformUsing(matrix);
+
+        if (isEmpty) {
+            bounds = box;
+            isEmpty = false;
+        } else {
+            bounds.expand(box);
+        }
+    };
+
+    if (isSkinned()) {
+        for (auto &joint : m_joints) {
+            if (joint.hasVertices) {
+                expandBy(joint.box, joint.inverseBindMatrix * worldMatrix(joint.node));
+            }
+        }
+    } else {
+        expandBy(m_meshBox, worldMatrix(&meshNode));
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Mesh.h"
+#include "macros.h"
+
+class NodeTransformCache;
+
+/**
+ * Computes conservative world-space bounds of a skinned or morphed mesh,
+ * without deforming its vertices.
+ *
+ * For each joint, the bounding box of the vertices it influences is precomputed.
+ * Since a skinned vertex is a weighted average of its positions transformed by each joint,
+ * it stays within the union of the boxes transformed by their joints.
+ *
+ * Blend shapes extend these boxes by the weighted range of their vertex offsets.
+ *
+ * All boxes are in glTF units, so including the bake scale factor.
+ */
+class MeshBounds {
+  public:
+    MeshBounds(const MainShape &mainShape, const MeshShapes &allShapes);
+    ~MeshBounds();
+
+    bool isSkinned() const { return !m_joints.empty(); }
+
+    size_t blendShapeCount() const { return m_offsetBoxes.size(); }
+
+    /**
+     * Expands the bounds by the mesh at the current time.
+     * @param meshNode The node that holds the mesh, only used when the mesh is not skinned.
+     * @param weights The current blend shape weights.
+     * @param isEmpty Is the bounds still empty? Cleared when the bounds are expanded.
+     */
+    void expand(NodeTransformCache &transformCache, const ExportableNode &meshNode, gsl::span<const float> weights,
+                const Arguments &args, MBoundingBox &bounds, bool &isEmpty) const;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(MeshBounds);
+
+    struct Joint {
+        const ExportableNode *node;
+        MMatrix inverseBindMatrix;
+
+        // The mesh-space bounds of the vertices influenced by the joint.
+        MBoundingBox box;
+
+        // Does the joint influence any vertex?
+        bool hasVertices;
+    };
+
+    std::vector<Joint> m_joints;
+
+    // The mesh-space bounds of all vertices, for meshes without a skin.
+    MBoundingBox m_meshBox;
+
+    // For each blend shape, the bounds of its vertex offsets.
+    std::vector<MBoundingBox> m_offsetBoxes;
+};
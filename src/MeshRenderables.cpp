@@ -38,9 +38,22 @@ MeshRenderables::MeshRenderables(const MeshShapes &meshShapes,
 
     const auto semanticsMask = args.meshPrimitiveAttributes;
 
+    // The source indices are only needed to bake vertex animation textures.
+    const auto needsSourceIndices =
+        args.vertexAnimationFormat != VertexAnimationFormat::None;
+
     auto totalWeldCount = 0;
     auto totalVertexCount = 0;
 
+    const auto mainSourceIndex = [&mainIndicesTable](
+                                     const Semantic::Kind semantic,
+                                     const int primitiveVertexIndex) {
+        const auto &indicesPerSet = mainIndicesTable.at(semantic);
+        return indicesPerSet.empty()
+                   ? NoIndex
+                   : indicesPerSet.at(0).at(primitiveVertexIndex);
+    };
+
     for (auto primitiveIndex = 0; primitiveIndex < primitiveCount;
          ++primitiveIndex) {
         const auto shaderIndex =
@@ -121,6 +134,13 @@ MeshRenderables::MeshRenderables(const MeshShapes &meshShapes,
                 vertexBuffer.vertexToIndexMapping[vertexIndexKey] =
                     sharedVertexIndex;
 
+                if (needsSourceIndices) {
+                    vertexBuffer.pointIndices.push_back(mainSourceIndex(
+                        Semantic::POSITION, primitiveVertexIndex));
+                    vertexBuffer.normalIndices.push_back(mainSourceIndex(
+                        Semantic::NORMAL, primitiveVertexIndex));
+                }
+
                 // Build the vertex.
                 for (auto &&slot : vertexLayout) {
                     auto &shape = meshShapes.at(slot.shapeIndex.arrayIndex());
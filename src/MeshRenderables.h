@@ -184,6 +184,12 @@ struct VertexBuffer {
     IndexVector indices;
     VertexElementsMap componentsMap;
 
+    // For each vertex, the index of the main shape point and normal it was
+    // built from, or NoIndex. Only filled when baking vertex animation
+    // textures.
+    IndexVector pointIndices;
+    IndexVector normalIndices;
+
     size_t maxIndex() const { return vertexToIndexMapping.size(); };
 };
 
@@ -48,6 +48,10 @@ MeshSkeleton::MeshSkeleton(ExportableScene &scene, const ExportableNode &node,
 
         m_joints.reserve(jointCount);
 
+        // The joint world positions, to compute their influence radius
+        std::vector<MPoint> jointOrigins;
+        jointOrigins.reserve(jointCount);
+
         // Gather the relevant input mesh data for the skinCluster
         const auto shapeDagPath = mesh.dagPath(&status);
         THROW_ON_FAILURE(status);
@@ -112,6 +116,10 @@ MeshSkeleton::MeshSkeleton(ExportableScene &scene, const ExportableNode &node,
             }
 
             m_joints.emplace_back(jointNode, inverseBindMatrix);
+
+            const auto jointMatrix = jointDagPath.inclusiveMatrix(&status);
+            THROW_ON_FAILURE(status);
+            jointOrigins.emplace_back(MPoint::origin * jointMatrix);
         }
 
         // Gather all joint index/weights per vertex, sorted ascendingly by
@@ -144,6 +152,9 @@ MeshSkeleton::MeshSkeleton(ExportableScene &scene, const ExportableNode &node,
             const MObject component = iterGeom.currentItem(&status);
             THROW_ON_FAILURE(status);
 
+            const auto worldPosition = iterGeom.position(MSpace::kWorld, &status);
+            THROW_ON_FAILURE(status);
+
             status = fnSkin.getWeights(meshDagPath, component, vertexWeights,
                                        numWeights);
             THROW_ON_FAILURE(status);
@@ -155,6 +166,11 @@ MeshSkeleton::MeshSkeleton(ExportableScene &scene, const ExportableNode &node,
                 const float jointWeight = vertexWeights[jointIndex];
                 if (std::abs(jointWeight) > 1e-6f) {
                     assignments.emplace_back(jointIndex, jointWeight);
+
+                    auto &joint = m_joints[jointIndex];
+                    joint.influenceRadius = std::max(
+                        joint.influenceRadius,
+                        worldPosition.distanceTo(jointOrigins[jointIndex]));
                 }
             }
 
@@ -36,6 +36,10 @@ struct MeshJoint {
     ExportableNode *node;
     MMatrix inverseBindMatrix;
 
+    // The largest world distance between the joint and the vertices it
+    // influences, at the initial values time.
+    double influenceRadius = 0;
+
     MeshJoint(ExportableNode *node, const MMatrix &inverseBindMatrix)
         : node(node), inverseBindMatrix(inverseBindMatrix) {}
 
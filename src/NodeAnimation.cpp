@@ -15,35 +15,38 @@ NodeAnimation::NodeAnimation(const ExportableNode &node, const ExportableFrames
 
     const size_t detectStepSampleCount = m_arguments.getStepDetectSampleCount();
 
+    // Step detection uses the same thresholds as constant detection
+    const auto &thresholds = node.constantThresholds;
+
     switch (node.transformKind) {
     case TransformKind::Simple:
-        m_positions = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
-        m_rotations = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
-        m_scales = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
+        m_positions = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, thresholds.translation, false);
+        m_rotations = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, thresholds.rotation, false);
+        m_scales = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, thresholds.scaling, false);
         break;
     case TransformKind::ComplexJoint:
-        m_positions = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
-        m_rotations = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
-        m_scales = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
+        m_positions = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, thresholds.translation, false);
+        m_rotations = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, thresholds.rotation, false);
+        m_scales = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, thresholds.scaling, false);
 
-        m_correctors = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
+        m_correctors = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, thresholds.scaling, false);
 
         if (m_arguments.forceAnimationChannels) {
-            m_dummyProps1 = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
-            m_dummyProps2 = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
+            m_dummyProps1 = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, 0, false);
+            m_dummyProps2 = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, 0, false);
         }
         break;
 
     case TransformKind::ComplexTransform:
-        m_positions = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
-        m_rotations = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
-        m_scales = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
+        m_positions = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, thresholds.translation, false);
+        m_rotations = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, thresholds.rotation, false);
+        m_scales = std::make_unique<PropAnimation>(frames, sNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, thresholds.scaling, false);
 
-        m_correctors = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, false);
+        m_correctors = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::TRANSLATION, 3, detectStepSampleCount, thresholds.translation, false);
 
         if (m_arguments.forceAnimationChannels) {
-            m_dummyProps1 = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, false);
-            m_dummyProps2 = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, false);
+            m_dummyProps1 = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::SCALE, 3, detectStepSampleCount, 0, false);
+            m_dummyProps2 = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::ROTATION, 4, detectStepSampleCount, 0, false);
         }
         break;
 
@@ -53,7 +56,9 @@ NodeAnimation::NodeAnimation(const ExportableNode &node, const ExportableFrames
     }
 
     if (m_blendShapeCount > 0) {
-        m_weights = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::WEIGHTS, m_blendShapeCount, detectStepSampleCount, true);
+        m_weights = std::make_unique<PropAnimation>(frames, pNode, GLTF::Animation::Path::WEIGHTS, m_blendShapeCount, detectStepSampleCount, thresholds.weights, true);
+
+        m_weights->useSparseOutputs = m_arguments.sparseWeights;
     }
 }
 
@@ -105,12 +110,17 @@ void NodeAnimation::sampleAt(const MTime &absoluteTime, const int frameIndex, co
     }
 
     if (m_blendShapeCount) {
-        auto weights = mesh->currentWeights();
-        assert(weights.size() == m_blendShapeCount);
-        m_weights->append(span(weights), superSampleIndex);
+        m_weights->appendWith(superSampleIndex, [this](gsl::span<float> weights) { mesh->readWeights(weights); });
     }
 }
 
+gsl::span<const float> NodeAnimation::lastFrameWeights() const {
+    if (!m_weights)
+        return {};
+
+    return m_weights->componentValues().last(static_cast<std::ptrdiff_t>(m_blendShapeCount));
+}
+
 void NodeAnimation::exportTo(GLTF::Animation &glAnimation) {
 
     if (!m_invalidLocalTransformTimes.empty()) {
@@ -132,35 +142,39 @@ void NodeAnimation::exportTo(GLTF::Animation &glAnimation) {
     auto &pTRS = node.initialTransformState.primaryTRS();
     auto &sTRS = node.initialTransformState.secondaryTRS();
 
+    const auto &thresholds = node.constantThresholds;
+    const auto &tolerances = node.keyframeTolerances;
+
     switch (node.transformKind) {
     case TransformKind::Simple:
-        finish(glAnimation, "T", m_positions, m_arguments.constantTranslationThreshold, pTRS.translation);
-        finish(glAnimation, "R", m_rotations, m_arguments.constantRotationThreshold, pTRS.rotation);
-        finish(glAnimation, "S", m_scales, m_arguments.constantScalingThreshold, pTRS.scale);
+        finish(glAnimation, "T", m_positions, thresholds.translation, tolerances.translation, pTRS.translation);
+        finish(glAnimation, "R", m_rotations, thresholds.rotation, tolerances.rotation, pTRS.rotation);
+        finish(glAnimation, "S", m_scales, thresholds.scaling, tolerances.scaling, pTRS.scale);
         break;
     case TransformKind::ComplexJoint:
-        finish(glAnimation, "T", m_positions, m_arguments.constantTranslationThreshold, sTRS.translation);
-        finish(glAnimation, "R", m_rotations, m_arguments.constantRotationThreshold, pTRS.rotation);
-        finish(glAnimation, "S", m_scales, m_arguments.constantScalingThreshold, pTRS.scale);
+        finish(glAnimation, "T", m_positions, thresholds.translation, tolerances.translation, sTRS.translation);
+        finish(glAnimation, "R", m_rotations, thresholds.rotation, tolerances.rotation, pTRS.rotation);
+        finish(glAnimation, "S", m_scales, thresholds.scaling, tolerances.scaling, pTRS.scale);
 
-        finish(glAnimation, "C", m_correctors, m_arguments.constantScalingThreshold, sTRS.scale);
+        finish(glAnimation, "C", m_correctors, thresholds.scaling, tolerances.scaling, sTRS.scale);
 
         if (m_arguments.forceAnimationChannels) {
-            finish(glAnimation, "DT", m_dummyProps1, 0, pTRS.translation);
-            finish(glAnimation, "DR", m_dummyProps2, 0, sTRS.rotation);
+            finish(glAnimation, "DT", m_dummyProps1, 0, 0, pTRS.translation);
+            finish(glAnimation, "DR", m_dummyProps2, 0, 0, sTRS.rotation);
         }
         break;
 
     case TransformKind::ComplexTransform:
-        finish(glAnimation, "T", m_positions, m_arguments.constantTranslationThreshold, sTRS.translation);
-        finish(glAnimation, "R", m_rotations, m_arguments.constantRotationThreshold, sTRS.rotation);
-        finish(glAnimation, "S", m_scales, m_arguments.constantScalingThreshold, sTRS.scale);
+        finish(glAnimation, "T", m_positions, thresholds.translation, tolerances.translation, sTRS.translation);
+        finish(glAnimation, "R", m_rotations, thresholds.rotation, tolerances.rotation, sTRS.rotation);
+        finish(glAnimation, "S", m_scales, thresholds.scaling, tolerances.scaling, sTRS.scale);
 
-        finish(glAnimation, "C", m_correctors, m_arguments.constantScalingThreshold, pTRS.translation);
+        // The corrector holds the pivot offset
+        finish(glAnimation, "C", m_correctors, thresholds.translation, tolerances.translation, pTRS.translation);
 
         if (m_arguments.forceAnimationChannels) {
-            finish(glAnimation, "DS", m_dummyProps1, 0, pTRS.scale);
-            finish(glAnimation, "DR", m_dummyProps2, 0, pTRS.rotation);
+            finish(glAnimation, "DS", m_dummyProps1, 0, 0, pTRS.scale);
+            finish(glAnimation, "DR", m_dummyProps2, 0, 0, pTRS.rotation);
         }
         break;
 
@@ -172,12 +186,12 @@ void NodeAnimation::exportTo(GLTF::Animation &glAnimation) {
     if (m_blendShapeCount) {
         const auto initialWeights = mesh->initialWeights();
         assert(initialWeights.size() == m_blendShapeCount);
-        finish(glAnimation, "W", m_weights, m_arguments.constantWeightsThreshold, initialWeights);
+        finish(glAnimation, "W", m_weights, thresholds.weights, tolerances.weights, initialWeights);
     }
 }
 
 void NodeAnimation::finish(GLTF::Animation &glAnimation, const char *propName, std::unique_ptr<PropAnimation> &animatedProp,
-    double constantThreshold, const gsl::span<const float> &baseValues) const {
+    double constantThreshold, double reductionTolerance, const gsl::span<const float> &baseValues) const {
     const auto dimension = animatedProp->dimension;
 
     if (dimension) {
@@ -185,11 +199,11 @@ void NodeAnimation::finish(GLTF::Animation &glAnimation, const char *propName, s
 
         const size_t detectStepSampleCount = m_arguments.getStepDetectSampleCount();
 
-        auto &componentValues = animatedProp->componentValuesPerFrameTable.at(0);
+        const auto componentValues = animatedProp->componentValues();
 
         // Check if all samples are constant. In that case, we drop the animation, unless it is forced
         bool isConstant = true;
-        for (size_t offset = 0; offset < componentValues.size() && isConstant; offset += dimension) {
+        for (size_t offset = 0; offset < static_cast<size_t>(componentValues.size()) && isConstant; offset += dimension) {
             for (size_t axis = 0; axis < dimension && isConstant; ++axis) {
                 isConstant = std::abs(baseValues[axis] - componentValues[offset + axis]) < constantThreshold;
             }
@@ -202,28 +216,29 @@ void NodeAnimation::finish(GLTF::Animation &glAnimation, const char *propName, s
             const auto useSingleKey = isConstant && !m_arguments.forceAnimationSampling;
             auto interpolation = "LINEAR";
 
+            std::vector<bool> heldFrames;
+
             if (!useSingleKey && detectStepSampleCount > 1) {
-                // Check if STEP animation can be used for this channel.
-                // TODO: Split into multiple parts!
-                auto canUseStep = true;
-                for (size_t offset = 0; offset < componentValues.size() && canUseStep; offset += dimension) {
-                    const auto* startValues = &componentValues[offset];
-                    for (size_t superSample = 1; superSample < detectStepSampleCount; ++superSample) {
-                        auto &stepComponentValues = animatedProp->componentValuesPerFrameTable.at(superSample);
-                        for (size_t axis = 0; axis < dimension; ++axis) {
-                            canUseStep = std::abs(startValues[axis] - stepComponentValues[offset + axis]) < constantThreshold;
-                        }
-                    }
-                }
+                // Check which frames hold their value until the next frame.
+                // If all frames do, STEP interpolation can be used for the whole channel,
+                // otherwise the held frames are emitted as steps between LINEAR keys.
+                heldFrames = animatedProp->heldFrames();
+
+                const auto heldCount = std::count(heldFrames.begin(), heldFrames.end(), true);
 
-                if (canUseStep) {
+                if (heldCount == static_cast<std::ptrdiff_t>(heldFrames.size())) {
                     std::cout << prefix << "Using STEP interpolation for channel " << node.name() << "/" << propName << std::endl;
                     interpolation = "STEP";
+                    heldFrames.clear();
+                } else if (heldCount == 0) {
+                    heldFrames.clear();
+                } else {
+                    std::cout << prefix << "Holding " << heldCount << " of " << heldFrames.size() << " frames of channel " << node.name() << "/" << propName << std::endl;
                 }
             }
 
-            // TODO: Apply a curve simplifier.
-            animatedProp->finish(m_arguments.disableNameAssignment ? "" : node.name() + "/anim/" + glAnimation.name + "/" + propName, useSingleKey, interpolation);
+            animatedProp->finish(m_arguments.disableNameAssignment ? "" : node.name() + "/anim/" + glAnimation.name + "/" + propName, useSingleKey, interpolation,
+                                 m_arguments.keyframeReduction, reductionTolerance, heldFrames);
             glAnimation.channels.push_back(&animatedProp->glChannel);
         }
     }
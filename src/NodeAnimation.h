@@ -22,6 +22,9 @@ class NodeAnimation {
 
     void exportTo(GLTF::Animation &glAnimation);
 
+    // The blend shape weights of the last sampled frame, empty when the mesh has no blend shapes
+    gsl::span<const float> lastFrameWeights() const;
+
     const ExportableNode &node;
     const ExportableMesh *mesh;
 
@@ -46,12 +49,13 @@ class NodeAnimation {
 
     std::unique_ptr<PropAnimation> m_weights;
 
-    void finish(GLTF::Animation &glAnimation, const char *propName, std::unique_ptr<PropAnimation> &animatedProp, double constantThreshold, const gsl::span<const float> &baseValues) const;
+    void finish(GLTF::Animation &glAnimation, const char *propName, std::unique_ptr<PropAnimation> &animatedProp, double constantThreshold,
+                double reductionTolerance, const gsl::span<const float> &baseValues) const;
 
     template <int N>
     void finish(GLTF::Animation &glAnimation, const char *propName, std::unique_ptr<PropAnimation> &animatedProp, 
-        double constantThreshold, int detectStepSampleCount, const float (&baseValues)[N]) {
-        finish(glAnimation, propName, animatedProp, constantThreshold, detectStepSampleCount, gsl::make_span(&baseValues[0], N));
+        double constantThreshold, double reductionTolerance, const float (&baseValues)[N]) {
+        finish(glAnimation, propName, animatedProp, constantThreshold, reductionTolerance, gsl::make_span(&baseValues[0], N));
     }
 
     DISALLOW_COPY_MOVE_ASSIGN(NodeAnimation);
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "CurveFitter.h"
 #include "ExportableFrames.h"
+#include "SparseAccessor.h"
 #include "accessors.h"
 #include "macros.h"
 
@@ -9,12 +11,22 @@ class ExportableNode;
 class PropAnimation {
   public:
     PropAnimation(const ExportableFrames &frames, const GLTF::Node &node, const GLTF::Animation::Path path, const size_t dimension,
-                  size_t stepDetectSampleCount, const bool useFloatArray)
-        : dimension(dimension), useFloatArray(useFloatArray), stepDetectSampleCount(stepDetectSampleCount), frames(frames) {
+                  size_t stepDetectSampleCount, const double stepThreshold, const bool useFloatArray)
+        : dimension(dimension), useFloatArray(useFloatArray), stepDetectSampleCount(stepDetectSampleCount), stepThreshold(stepThreshold),
+          frames(frames) {
 
-        componentValuesPerFrameTable.resize(stepDetectSampleCount);
-        for (auto superSample = 0; superSample < stepDetectSampleCount; ++superSample) {
-            componentValuesPerFrameTable[superSample].reserve(frames.count * dimension);
+        // All frames are allocated upfront, so streamed samples don't need to move.
+        const auto valueCount = static_cast<size_t>(frames.count) * dimension;
+
+        if (auto *store = frames.sampleStore()) {
+            m_values = store->allocate(valueCount);
+        } else {
+            m_ownedValues.resize(valueCount);
+            m_values = gsl::make_span(m_ownedValues);
+        }
+
+        if (stepDetectSampleCount > 1) {
+            m_heldFrames.reserve(frames.count);
         }
 
         glTarget.node = &const_cast<GLTF::Node &>(node);
@@ -29,30 +41,62 @@ class PropAnimation {
     const size_t dimension;
     const bool useFloatArray;
     const size_t stepDetectSampleCount;
+    const double stepThreshold;
     const ExportableFrames &frames;
 
-    // For each step-detection super-sampling frame, a vector of component values
-    std::vector<std::vector<float>> componentValuesPerFrameTable;
+    // Write the outputs as a sparse accessor, when that is smaller?
+    bool useSparseOutputs = false;
+
+    // The component values of each frame, or of each key once the keys are reduced.
+    // The step-detection super-samples are not stored, they are compared with the frame values as they arrive.
+    gsl::span<const float> componentValues() const { return m_values.first(static_cast<std::ptrdiff_t>(m_valueCount)); }
 
     GLTF::Animation::Channel glChannel;
     GLTF::Animation::Sampler glSampler;
     GLTF::Animation::Channel::Target glTarget;
 
     template <std::ptrdiff_t Extent> void append(const gsl::span<const float, Extent> &components, size_t superSample) {
-        std::copy(components.begin(), components.end(), std::back_inserter(componentValuesPerFrameTable.at(superSample)));
+        assert(components.size() == dimension);
+
+        if (superSample == 0) {
+            std::copy(components.begin(), components.end(), m_values.begin() + m_valueCount);
+            m_valueCount += dimension;
+
+            if (stepDetectSampleCount > 1) {
+                m_heldFrames.push_back(true);
+            }
+        } else {
+            updateHeldFrame(components.data());
+        }
     }
 
-    void appendQuaternion(const gsl::span<const float, 4> &q, int superSample) {
-        auto &componentValuesPerFrame = componentValuesPerFrameTable.at(superSample);
+    // Appends a sample by letting the reader write the components directly into the storage, avoiding temporaries.
+    template <typename Reader> void appendWith(size_t superSample, Reader read) {
+        if (superSample == 0) {
+            read(m_values.subspan(static_cast<std::ptrdiff_t>(m_valueCount), static_cast<std::ptrdiff_t>(dimension)));
+            m_valueCount += dimension;
+
+            if (stepDetectSampleCount > 1) {
+                m_heldFrames.push_back(true);
+            }
+        } else {
+            m_superSampleValues.resize(dimension);
+            read(gsl::make_span(m_superSampleValues));
+            updateHeldFrame(m_superSampleValues.data());
+        }
+    }
 
-        const auto index = componentValuesPerFrame.size();
-        if (index == 0) {
+    void appendQuaternion(const gsl::span<const float, 4> &q, int superSample) {
+        // The first sample of a frame is matched with the previous frame, the super-samples with the first sample of their frame.
+        if (superSample == 0 && m_valueCount == 0) {
             append(q, superSample);
         } else {
-            auto x0 = componentValuesPerFrame[index - 4];
-            auto y0 = componentValuesPerFrame[index - 3];
-            auto z0 = componentValuesPerFrame[index - 2];
-            auto w0 = componentValuesPerFrame[index - 1];
+            const auto *q0 = lastFrameValues();
+
+            auto x0 = q0[0];
+            auto y0 = q0[1];
+            auto z0 = q0[2];
+            auto w0 = q0[3];
 
             auto x1 = q[0];
             auto y1 = q[1];
@@ -70,31 +114,73 @@ class PropAnimation {
                 w1 = -w1;
             }
 
-            componentValuesPerFrame.push_back(x1);
-            componentValuesPerFrame.push_back(y1);
-            componentValuesPerFrame.push_back(z1);
-            componentValuesPerFrame.push_back(w1);
+            const std::array<float, 4> q1{x1, y1, z1, w1};
+            append(gsl::make_span(q1), superSample);
         }
     }
 
-    void finish(const std::string &name, const bool useSingleKey, const char *interpolation) {
+    // For each frame, are all its step-detection samples equal to the value of the frame, within the step threshold?
+    const std::vector<bool> &heldFrames() const { return m_heldFrames; }
+
+    // When heldFrames is not empty, the held frames keep their value until their last step-detection sample,
+    // the other frames are interpolated linearly.
+    void finish(const std::string &name, const bool useSingleKey, const char *interpolation, const KeyframeReduction reduction,
+                const double reductionTolerance, const std::vector<bool> &heldFrames) {
         glSampler.interpolation = interpolation;
 
         if (!m_outputs) {
-            auto &componentValuesPerFrame = componentValuesPerFrameTable.at(0);
-
             if (useSingleKey) {
-                componentValuesPerFrame.resize(dimension);
+                m_valueCount = dimension;
                 glSampler.input = frames.glInput0();
+            } else if (!heldFrames.empty()) {
+                FittedCurve curve;
+                appendHeldKeys(heldFrames, curve);
+
+                if (reduction != KeyframeReduction::None) {
+                    // Tangents are not defined at the steps, so only linear keys are used.
+                    const CurveFitter fitter(span(curve.times), span(curve.values), dimension);
+                    FittedCurve reducedCurve;
+                    fitter.fitLinear(reductionTolerance, reducedCurve);
+                    curve = std::move(reducedCurve);
+                }
+
+                setKeys(name, curve);
+            } else if (strcmp(interpolation, "STEP") == 0) {
+                // Only keep the keys where the value changes
+                FittedCurve curve;
+                appendStepKeys(reduction == KeyframeReduction::None ? 0 : reductionTolerance, curve);
+                setKeys(name, curve);
+            } else if (reduction != KeyframeReduction::None) {
+                const CurveFitter fitter(frames.times(), componentValues(), dimension);
+
+                FittedCurve curve;
+                fitter.fitLinear(reductionTolerance, curve);
+
+                if (reduction == KeyframeReduction::Cubic) {
+                    // Cubic keys are three times as large, only use them when they are smaller than the linear ones.
+                    FittedCurve cubicCurve;
+                    fitter.fitCubic(reductionTolerance, cubicCurve);
+
+                    if (cubicCurve.values.size() < curve.values.size()) {
+                        curve = std::move(cubicCurve);
+                        glSampler.interpolation = "CUBICSPLINE";
+                    }
+                }
+
+                setKeys(name, curve);
             } else {
                 glSampler.input = frames.glInputs();
             }
 
-            if (stepDetectSampleCount > 1 && !useSingleKey) {
-                // Remove all
+            const auto outputDimension = useFloatArray ? 1 : dimension;
+
+            if (useSparseOutputs) {
+                m_outputs = sparseChannelAccessor(name, componentValues(), outputDimension);
             }
 
-            m_outputs = contiguousChannelAccessor(name, span(componentValuesPerFrame), useFloatArray ? 1 : dimension);
+            if (!m_outputs) {
+                m_outputs = contiguousChannelAccessor(name, componentValues(), outputDimension);
+            }
 
             glSampler.output = m_outputs.get();
 
@@ -106,5 +192,94 @@ class PropAnimation {
 private:
     std::unique_ptr<GLTF::Accessor> m_outputs;
 
+    // Either m_ownedValues, or storage in the sample store of the frames
+    gsl::span<float> m_values;
+    size_t m_valueCount = 0;
+    std::vector<float> m_ownedValues;
+
+    std::vector<bool> m_heldFrames;
+
+    // Scratch storage for a super-sample, see appendWith
+    std::vector<float> m_superSampleValues;
+
+    void updateHeldFrame(const float *components) {
+        if (!m_heldFrames.back())
+            return;
+
+        const auto *frameValues = lastFrameValues();
+        for (size_t axis = 0; axis < dimension; ++axis) {
+            if (std::abs(frameValues[axis] - components[axis]) >= stepThreshold) {
+                m_heldFrames.back() = false;
+                break;
+            }
+        }
+    }
+
+    const float *frameValues(const size_t frameIndex) const { return &m_values[frameIndex * dimension]; }
+
+    const float *lastFrameValues() const { return &m_values[m_valueCount - dimension]; }
+
+    bool areFrameValuesEqual(const size_t frameIndex1, const size_t frameIndex2, const double tolerance) const {
+        const auto *values1 = frameValues(frameIndex1);
+        const auto *values2 = frameValues(frameIndex2);
+        for (size_t axis = 0; axis < dimension; ++axis) {
+            if (std::abs(values1[axis] - values2[axis]) > tolerance)
+                return false;
+        }
+        return true;
+    }
+
+    void appendKey(const float time, const size_t frameIndex, FittedCurve &curve) const {
+        const auto *values = frameValues(frameIndex);
+        curve.times.push_back(time);
+        curve.values.insert(curve.values.end(), values, values + dimension);
+    }
+
+    // Emits a key per frame, and an extra key just before the next frame for each held frame that precedes a change,
+    // so LINEAR interpolation holds the value, and jumps to the next value at the next frame, like STEP interpolation.
+    void appendHeldKeys(const std::vector<bool> &heldFrames, FittedCurve &curve) const {
+        const auto times = frames.times();
+        const auto frameCount = static_cast<size_t>(frames.count);
+
+        for (size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+            appendKey(times[frameIndex], frameIndex, curve);
+
+            const auto nextFrameIndex = frameIndex + 1;
+            if (heldFrames[frameIndex] && nextFrameIndex < frameCount && !areFrameValuesEqual(frameIndex, nextFrameIndex, 0)) {
+                // The largest time before the next frame, so the ramp to the next value can't be seen.
+                const auto holdEndTime = std::nextafter(times[nextFrameIndex], times[frameIndex]);
+                appendKey(holdEndTime, frameIndex, curve);
+            }
+        }
+    }
+
+    void appendStepKeys(const double tolerance, FittedCurve &curve) const {
+        const auto times = frames.times();
+        const auto frameCount = static_cast<size_t>(frames.count);
+
+        size_t keyFrameIndex = 0;
+
+        for (size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+            if (frameIndex == 0 || !areFrameValuesEqual(keyFrameIndex, frameIndex, tolerance)) {
+                appendKey(times[frameIndex], frameIndex, curve);
+                keyFrameIndex = frameIndex;
+            }
+        }
+    }
+
+    void setKeys(const std::string &name, FittedCurve &curve) {
+        const auto times = frames.times();
+
+        if (std::equal(curve.times.begin(), curve.times.end(), times.begin(), times.end())) {
+            glSampler.input = frames.glInputs();
+        } else {
+            glSampler.input = frames.glKeyInputs(name.empty() ? name : name + "/keys", span(curve.times));
+        }
+
+        m_ownedValues = std::move(curve.values);
+        m_values = gsl::make_span(m_ownedValues);
+        m_valueCount = m_ownedValues.size();
+    }
+
     DISALLOW_COPY_MOVE_ASSIGN(PropAnimation);
 };
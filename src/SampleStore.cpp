@@ -0,0 +1,107 @@
+#include "externals.h"
+
+#include "SampleStore.h"
+#include "filesystem.h"
+
+#ifdef _MSC_VER
+// Keep windows.h from defining min and max macros, these break std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+SampleStore::SampleStore() {
+    const auto folder = fs::temp_directory_path().string();
+
+#ifdef _MSC_VER
+    char path[MAX_PATH];
+    if (!GetTempFileNameA(folder.c_str(), "m2g", 0, path))
+        throw std::runtime_error("Failed to create a temporary file for the animation samples in " + folder);
+
+    m_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                         FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+
+    if (m_file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error(std::string("Failed to open temporary file ") + path);
+#else
+    auto path = (fs::path(folder) / "maya2glTF-samples-XXXXXX").string();
+
+    m_file = mkstemp(&path[0]);
+    if (m_file < 0)
+        throw std::runtime_error("Failed to create a temporary file for the animation samples in " + folder);
+
+    // The file is deleted as soon as it is closed.
+    unlink(path.c_str());
+#endif
+}
+
+SampleStore::~SampleStore() {
+#ifdef _MSC_VER
+    for (auto &block : m_blocks) {
+        UnmapViewOfFile(block.data);
+    }
+
+    for (auto mapping : m_mappings) {
+        CloseHandle(mapping);
+    }
+
+    CloseHandle(m_file);
+#else
+    for (auto &block : m_blocks) {
+        munmap(block.data, block.byteLength);
+    }
+
+    close(m_file);
+#endif
+}
+
+SampleStore::Block SampleStore::mapBlock(const size_t byteLength) {
+    const auto offset = m_fileLength;
+    const auto fileLength = offset + byteLength;
+
+#ifdef _MSC_VER
+    // Mapping beyond the end of the file grows it.
+    const auto mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(uint64_t(fileLength) >> 32),
+                                            static_cast<DWORD>(fileLength), nullptr);
+    if (!mapping)
+        throw std::runtime_error("Failed to map the temporary animation samples file");
+
+    m_mappings.push_back(mapping);
+
+    const auto data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, static_cast<DWORD>(uint64_t(offset) >> 32), static_cast<DWORD>(offset),
+                                    byteLength);
+    if (!data)
+        throw std::runtime_error("Failed to map the temporary animation samples file");
+#else
+    if (ftruncate(m_file, static_cast<off_t>(fileLength)) != 0)
+        throw std::runtime_error("Failed to grow the temporary animation samples file");
+
+    const auto data = mmap(nullptr, byteLength, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, static_cast<off_t>(offset));
+    if (data == MAP_FAILED)
+        throw std::runtime_error("Failed to map the temporary animation samples file");
+#endif
+
+    m_fileLength = fileLength;
+
+    return {data, byteLength};
+}
+
+gsl::span<float> SampleStore::allocate(const size_t count) {
+    const auto byteLength = count * sizeof(float);
+
+    if (m_blocks.empty() || m_blockOffset + byteLength > m_blocks.back().byteLength) {
+        const auto blockLength = std::max(defaultBlockLength, (byteLength + blockAlignment - 1) / blockAlignment * blockAlignment);
+        m_blocks.push_back(mapBlock(blockLength));
+        m_blockOffset = 0;
+    }
+
+    auto *data = reinterpret_cast<float *>(static_cast<uint8_t *>(m_blocks.back().data) + m_blockOffset);
+    m_blockOffset += byteLength;
+
+    return gsl::make_span(data, count);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * Stores animation samples in a temporary file that is mapped into memory,
+ * so the operating system can page them out while a long clip is sampled.
+ *
+ * The file is mapped in large blocks, and allocations never move,
+ * so the returned spans stay valid until the store is destroyed.
+ * The temporary file is deleted when the store is destroyed.
+ */
+class SampleStore {
+  public:
+    SampleStore();
+    ~SampleStore();
+
+    /** Allocates room for count floats, initially zero */
+    gsl::span<float> allocate(size_t count);
+
+    /** The number of bytes mapped so far */
+    size_t byteLength() const { return m_fileLength; }
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(SampleStore);
+
+    // Blocks are multiples of this, which is the allocation granularity on Windows, and a multiple of the page size elsewhere.
+    static constexpr size_t blockAlignment = 64 * 1024;
+
+    static constexpr size_t defaultBlockLength = 64 * 1024 * 1024;
+
+    struct Block {
+        void *data;
+        size_t byteLength;
+    };
+
+    std::vector<Block> m_blocks;
+
+    // The unused part of the last block
+    size_t m_blockOffset = 0;
+
+    size_t m_fileLength = 0;
+
+#ifdef _MSC_VER
+    void *m_file;
+    std::vector<void *> m_mappings;
+#else
+    int m_file;
+#endif
+
+    Block mapBlock(size_t byteLength);
+};
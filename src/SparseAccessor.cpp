@@ -0,0 +1,90 @@
+#include "externals.h"
+
+#include "SparseAccessor.h"
+#include "accessors.h"
+
+SparseAccessor::SparseAccessor(const Type type, const int count, std::unique_ptr<GLTF::Accessor> indices,
+                               std::unique_ptr<GLTF::Accessor> values)
+    : GLTF::Accessor(type, GLTF::Constants::WebGL::FLOAT), m_indices(std::move(indices)), m_values(std::move(values)) {
+    this->count = count;
+}
+
+SparseAccessor::~SparseAccessor() = default;
+
+void SparseAccessor::writeJSON(void *writer, GLTF::Options *options) {
+    GLTF::Accessor::writeJSON(writer, options);
+
+    if (!m_indices)
+        return;
+
+    // The buffer views of the indices and values get their ids before the asset is written.
+    if (!m_indices->bufferView || m_indices->bufferView->id < 0 || !m_values->bufferView || m_values->bufferView->id < 0)
+        throw std::runtime_error("The indices and values of sparse accessor '" + name + "' have no buffer view id");
+
+    auto *jsonWriter = static_cast<rapidjson::Writer<rapidjson::StringBuffer> *>(writer);
+
+    jsonWriter->Key("sparse");
+    jsonWriter->StartObject();
+    {
+        jsonWriter->Key("count");
+        jsonWriter->Int(m_indices->count);
+
+        jsonWriter->Key("indices");
+        jsonWriter->StartObject();
+        jsonWriter->Key("bufferView");
+        jsonWriter->Int(m_indices->bufferView->id);
+        jsonWriter->Key("byteOffset");
+        jsonWriter->Int(m_indices->byteOffset);
+        jsonWriter->Key("componentType");
+        jsonWriter->Int(static_cast<int>(m_indices->componentType));
+        jsonWriter->EndObject();
+
+        jsonWriter->Key("values");
+        jsonWriter->StartObject();
+        jsonWriter->Key("bufferView");
+        jsonWriter->Int(m_values->bufferView->id);
+        jsonWriter->Key("byteOffset");
+        jsonWriter->Int(m_values->byteOffset);
+        jsonWriter->EndObject();
+    }
+    jsonWriter->EndObject();
+}
+
+std::unique_ptr<GLTF::Accessor> sparseChannelAccessor(const std::string &name, const gsl::span<const float> &data, const size_t dimension) {
+    const auto elementCount = data.size() / dimension;
+
+    std::vector<uint32_t> indices;
+    std::vector<float> values;
+
+    for (size_t elementIndex = 0; elementIndex < elementCount; ++elementIndex) {
+        const auto *element = &data[elementIndex * dimension];
+        if (std::any_of(element, element + dimension, [](const float v) { return v != 0; })) {
+            indices.push_back(static_cast<uint32_t>(elementIndex));
+            values.insert(values.end(), element, element + dimension);
+        }
+    }
+
+    // Each sparse element needs an index and its values.
+    const auto sparseByteLength = indices.size() * sizeof(uint32_t) + values.size() * sizeof(float);
+    const auto contiguousByteLength = data.size() * sizeof(float);
+
+    if (sparseByteLength >= contiguousByteLength)
+        return nullptr;
+
+    std::unique_ptr<GLTF::Accessor> indicesAccessor;
+    std::unique_ptr<GLTF::Accessor> valuesAccessor;
+
+    if (!indices.empty()) {
+        // Use 32-bit indices, so the indices and values can share a buffer view.
+        indicesAccessor = contiguousAccessor(name.empty() ? name : name + "/sparse/indices", GLTF::Accessor::Type::SCALAR,
+                                             GLTF::Constants::WebGL::UNSIGNED_INT, static_cast<GLTF::Constants::WebGL>(-1),
+                                             span(indices), 1);
+
+        valuesAccessor = contiguousChannelAccessor(name.empty() ? name : name + "/sparse/values", span(values), dimension);
+    }
+
+    auto accessor = std::make_unique<SparseAccessor>(glAccessorType(dimension), static_cast<int>(elementCount), std::move(indicesAccessor),
+                                                     std::move(valuesAccessor));
+    accessor->name = name;
+    return accessor;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * An accessor that only stores its non-zero elements, using glTF sparse storage.
+ * It has no buffer view, so all other elements are zero.
+ *
+ * The indices and values are stored in separate accessors, that the glTF asset doesn't reference,
+ * so their buffer views must get ids before the asset is written, see ExportableAsset::save.
+ *
+ * Only zero elements are left out: glTF sparse storage replaces elements of an all-zero base
+ * when there is no buffer view, so elements held at a constant non-zero value are still stored.
+ */
+class SparseAccessor : public GLTF::Accessor {
+  public:
+    SparseAccessor(Type type, int count, std::unique_ptr<GLTF::Accessor> indices, std::unique_ptr<GLTF::Accessor> values);
+    ~SparseAccessor() override;
+
+    // Null when all elements are zero
+    GLTF::Accessor *indices() const { return m_indices.get(); }
+
+    // Null when all elements are zero
+    GLTF::Accessor *values() const { return m_values.get(); }
+
+    void writeJSON(void *writer, GLTF::Options *options) override;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(SparseAccessor);
+
+    std::unique_ptr<GLTF::Accessor> m_indices;
+    std::unique_ptr<GLTF::Accessor> m_values;
+};
+
+// Creates a sparse accessor storing only the non-zero elements of the data,
+// or returns null when a contiguous accessor would not be larger.
+std::unique_ptr<GLTF::Accessor> sparseChannelAccessor(const std::string &name, const gsl::span<const float> &data, size_t dimension);
@@ -0,0 +1,36 @@
+#include "externals.h"
+
+#include "TimeAccessorPool.h"
+#include "accessors.h"
+
+TimeAccessorPool::~TimeAccessorPool() = default;
+
+// FNV-1a over the bytes of the times, the frame count and rate are implied by these.
+static size_t contentHash(const gsl::span<const float> times) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto b : reinterpret_span<byte>(times)) {
+        hash = (hash ^ b) * 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+GLTF::Accessor *TimeAccessorPool::get(const std::string &accessorName, const gsl::span<const float> times) {
+    const auto hash = contentHash(times);
+
+    const auto range = m_entryIndices.equal_range(hash);
+
+    for (auto it = range.first; it != range.second; ++it) {
+        auto &entry = m_entries[it->second];
+        if (std::equal(entry.times.begin(), entry.times.end(), times.begin(), times.end()))
+            return entry.accessor.get();
+    }
+
+    Entry entry;
+    entry.times.assign(times.begin(), times.end());
+    entry.accessor = contiguousChannelAccessor(accessorName, times, 1);
+
+    m_entryIndices.emplace(hash, m_entries.size());
+    m_entries.emplace_back(std::move(entry));
+
+    return m_entries.back().accessor.get();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * Owns the animation sampler input accessors of all clips,
+ * sharing a single accessor between all samplers with identical key times.
+ *
+ * Clips with the same frame count and frame rate, and channels whose keys were reduced
+ * to the same times, then all reference the same input accessor.
+ */
+class TimeAccessorPool {
+  public:
+    TimeAccessorPool() = default;
+    ~TimeAccessorPool();
+
+    /**
+     * Gets the accessor for the given key times, creating it when the pool doesn't have one yet.
+     * @param accessorName The name of the accessor, when it must be created.
+     * @param times The time of each key, in seconds.
+     */
+    GLTF::Accessor *get(const std::string &accessorName, gsl::span<const float> times);
+
+    /** The number of distinct input accessors */
+    size_t size() const { return m_entries.size(); }
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(TimeAccessorPool);
+
+    struct Entry {
+        std::vector<float> times;
+        std::unique_ptr<GLTF::Accessor> accessor;
+    };
+
+    std::vector<Entry> m_entries;
+
+    // Content hash to entry index. Entries with the same hash are compared by their times.
+    std::unordered_multimap<size_t, size_t> m_entryIndices;
+};
@@ -2,6 +2,7 @@
 
 #include "ExportableNode.h"
 #include "MayaException.h"
+#include "MayaUtils.h"
 #include "Transform.h"
 
 const double epsilon = 1e-4f;
@@ -25,13 +26,6 @@ double getAxesNonOrthogonality(const MMatrix &m) {
     return e;
 }
 
-void getTranslation(const MTransformationMatrix &m, float *result, double scaleFactor, const double posPrecision) {
-    const MVector t = m.getTranslation(MSpace::kPostTransform);
-    result[0] = roundToFloat(t.x * scaleFactor, posPrecision);
-    result[1] = roundToFloat(t.y * scaleFactor, posPrecision);
-    result[2] = roundToFloat(t.z * scaleFactor, posPrecision);
-}
-
 void getScaling(const MTransformationMatrix &m, float *result, const double sclPrecision) {
     double s[3];
     THROW_ON_FAILURE(m.getScale(s, MSpace::kPostTransform));
@@ -69,29 +63,6 @@ GLTF::Node::TransformMatrix toGLTF(const MMatrix &matrix) {
         m[0][2], m[1][2], m[2][2], m[3][2], m[0][3], m[1][3], m[2][3], m[3][3]);
 }
 
-MMatrix getObjectSpaceMatrix(const MDagPath &dagPath,
-                             const MDagPath &parentPath) {
-    MStatus status;
-
-    MFnDagNode fnDagNode(dagPath, &status);
-    THROW_ON_FAILURE(status);
-
-    const auto childWorldMatrix = dagPath.inclusiveMatrix(&status);
-    THROW_ON_FAILURE(status);
-
-    const auto parentPathLength = parentPath.length(&status);
-    THROW_ON_FAILURE(status);
-
-    if (parentPathLength == 0)
-        return childWorldMatrix;
-
-    const auto parentWorldMatrixInverse =
-        parentPath.inclusiveMatrixInverse(&status);
-    THROW_ON_FAILURE(status);
-
-    return childWorldMatrix * parentWorldMatrixInverse;
-}
-
 void makeIdentity(GLTF::Node::TransformTRS &trs) {
     trs.translation[0] = 0;
     trs.translation[1] = 0;
@@ -107,142 +78,342 @@ void makeIdentity(GLTF::Node::TransformTRS &trs) {
     trs.rotation[3] = 1;
 }
 
+NodeTransformCache::NodeTransformCache() {
+    makeIdentity(m_worldState.localTransforms[0]);
+    makeIdentity(m_worldState.localTransforms[1]);
+    m_worldState.isInitialized = 1;
+}
+
 const NodeTransformState &
 NodeTransformCache::getTransform(const ExportableNode *node,
                                  const double scaleFactor,
                                  const double posPrecision,
                                  const double sclPrecision,
                                  const double dirPrecision) {
-    auto &state = m_table[node];
+    if (node == nullptr)
+        return m_worldState;
+
+    const auto index = node->index;
+
+    if (index >= m_states.size()) {
+        m_states.resize(index + 1);
+        m_generations.resize(index + 1, 0);
+    }
+
+    if (m_generations[index] == m_generation) {
+        const auto &state = m_states[index];
+
+        if (state.isInitialized < 0)
+            throw std::runtime_error(
+                "Ouch! Infinite loop detected in NodeTransformCache");
 
-    if (state.isInitialized > 0)
         return state;
+    }
+
+    m_generations[index] = m_generation;
+    m_states[index].isInitialized = -1;
+
+    // The world matrix and segment scale compensation need the parent.
+    // Get it before referencing the state, since this might grow the table.
+    // When sampling parents first, this is just a lookup.
+    const auto &parentState =
+        getTransform(node->parentNode, scaleFactor, posPrecision, sclPrecision,
+                     dirPrecision);
+
+    const MMatrix parentWorldMatrix = parentState.worldMatrix;
+
+    float parentScale[3];
+    std::copy_n(parentState.primaryTRS().scale, 3, parentScale);
+
+    MMatrix localMatrix;
+    const auto worldMatrix =
+        computeMatrices(node, parentWorldMatrix, localMatrix);
+
+    auto &state = m_states[index];
+
+    state.worldMatrix = worldMatrix;
+
+    const auto rotationScaleMatrix =
+        prepareTransform(node, localMatrix, parentScale, state, scaleFactor,
+                         posPrecision, sclPrecision);
+
+    decomposeRotationScale(rotationScaleMatrix,
+                           state.localTransforms[rotationScaleIndex(node)],
+                           state, sclPrecision, dirPrecision);
+
+    state.isInitialized = 1;
+
+    return state;
+}
+
+void NodeTransformCache::evaluate(
+    const gsl::span<const ExportableNode *const> nodes,
+    const double scaleFactor, const double posPrecision,
+    const double sclPrecision, const double dirPrecision) {
+    m_pendingNodes.clear();
+
+    // First compute the world and local matrices, parents first.
+    size_t levelCount = 0;
+
+    for (auto *node : nodes) {
+        const auto index = node->index;
+
+        if (index >= m_states.size()) {
+            m_states.resize(index + 1);
+            m_generations.resize(index + 1, 0);
+        }
+
+        if (m_generations[index] == m_generation)
+            continue;
+
+        if (index >= m_levels.size()) {
+            m_levels.resize(index + 1);
+            m_localMatrices.resize(index + 1);
+        }
+
+        // The rotation and scale of a joint with segment scale compensation
+        // depend on the scale of the parent, so when the parent is part of
+        // this batch, it must be decomposed in a later level.
+        const auto *parentNode = node->parentNode;
+
+        MMatrix parentWorldMatrix;
+        size_t level = 0;
+
+        if (parentNode && isPending(parentNode)) {
+            parentWorldMatrix = m_states[parentNode->index].worldMatrix;
+
+            if (node->transformKind == TransformKind::ComplexJoint) {
+                level = m_levels[parentNode->index] + 1;
+            }
+        } else {
+            parentWorldMatrix =
+                getTransform(parentNode, scaleFactor, posPrecision,
+                             sclPrecision, dirPrecision)
+                    .worldMatrix;
+        }
 
-    if (state.isInitialized < 0)
-        throw std::runtime_error(
-            "Ouch! Infinite loop detected in NodeTransformCache");
+        m_generations[index] = m_generation;
 
-    state.isInitialized = -1;
+        auto &state = m_states[index];
+        state.isInitialized = -1;
+        state.worldMatrix =
+            computeMatrices(node, parentWorldMatrix, m_localMatrices[index]);
 
+        m_levels[index] = level;
+        levelCount = std::max(levelCount, level + 1);
+
+        m_pendingNodes.push_back(node);
+    }
+
+    // Then decompose all matrices of each level in one batch.
+    for (size_t level = 0; level < levelCount; ++level) {
+        m_batch.clear();
+        m_batchNodes.clear();
+        m_batchMatrices.clear();
+
+        for (auto *node : m_pendingNodes) {
+            const auto index = node->index;
+
+            if (m_levels[index] != level)
+                continue;
+
+            // Only joints with segment scale compensation need the parent
+            // scale. Their parent was decomposed in a lower level, other
+            // parents might still be pending in this level.
+            const float unitScale[3] = {1, 1, 1};
+            const float *parentScale = unitScale;
+
+            if (node->transformKind == TransformKind::ComplexJoint) {
+                parentScale = getTransform(node->parentNode, scaleFactor,
+                                           posPrecision, sclPrecision,
+                                           dirPrecision)
+                                  .primaryTRS()
+                                  .scale;
+            }
+
+            const auto m = prepareTransform(
+                node, m_localMatrices[index], parentScale, m_states[index],
+                scaleFactor, posPrecision, sclPrecision);
+
+            m_batch.add(m[0], m[1], m[2]);
+            m_batchNodes.push_back(node);
+            m_batchMatrices.push_back(m);
+        }
+
+        m_batch.decompose(MAX_NON_ORTHOGONALITY, sclPrecision, dirPrecision);
+
+        for (size_t batchIndex = 0; batchIndex < m_batchNodes.size();
+             ++batchIndex) {
+            auto *node = m_batchNodes[batchIndex];
+            auto &state = m_states[node->index];
+            auto &trs = state.localTransforms[rotationScaleIndex(node)];
+
+            if (m_batch.isRegular(batchIndex)) {
+                state.maxNonOrthogonality =
+                    m_batch.nonOrthogonality(batchIndex);
+                m_batch.getRotation(batchIndex, trs.rotation);
+                m_batch.getScale(batchIndex, trs.scale);
+            } else {
+                // Skewed or mirrored, let Maya decompose it, as before.
+                decomposeRotationScale(m_batchMatrices[batchIndex], trs, state,
+                                       sclPrecision, dirPrecision);
+            }
+
+            state.isInitialized = 1;
+        }
+    }
+}
+
+bool NodeTransformCache::isPending(const ExportableNode *node) const {
+    const auto index = node->index;
+    return index < m_generations.size() &&
+           m_generations[index] == m_generation &&
+           m_states[index].isInitialized < 0;
+}
+
+size_t NodeTransformCache::rotationScaleIndex(const ExportableNode *node) {
+    return node->transformKind == TransformKind::ComplexTransform;
+}
+
+MMatrix NodeTransformCache::computeMatrices(const ExportableNode *node,
+                                            const MMatrix &parentWorldMatrix,
+                                            MMatrix &localMatrix) {
+    MStatus status;
+
+    if (node->hasDagParentTransform) {
+        // Only read the node's own matrix, and reuse the world matrix of
+        // the parent, instead of walking the full DAG path.
+        localMatrix = utils::getMatrix(node->localMatrixPlug);
+        return localMatrix * parentWorldMatrix;
+    }
+
+    // Logical parent, or a transform that doesn't inherit the parent's.
+    const auto worldMatrix = node->dagPath.inclusiveMatrix(&status);
+    THROW_ON_FAILURE(status);
+
+    localMatrix = node->parentNode
+                      ? worldMatrix * getWorldMatrixInverse(node->parentNode)
+                      : worldMatrix;
+
+    return worldMatrix;
+}
+
+MMatrix NodeTransformCache::prepareTransform(
+    const ExportableNode *node, const MMatrix &localMatrix,
+    const float *parentScale, NodeTransformState &state,
+    const double scaleFactor, const double posPrecision,
+    const double sclPrecision) {
     auto &trs0 = state.localTransforms[0];
     makeIdentity(trs0);
 
     auto &trs1 = state.localTransforms[1];
     makeIdentity(trs1);
 
-    if (node == nullptr) {
-        // World
-        state.requiresExtraNode = false;
-        state.maxNonOrthogonality = 0;
-    } else {
-        state.requiresExtraNode = node->transformKind != TransformKind::Simple;
-
-        const auto localMatrix =
-            getObjectSpaceMatrix(node->dagPath, node->parentDagPath());
-
-        switch (node->transformKind) {
-        case TransformKind::Simple: {
-            state.maxNonOrthogonality = getAxesNonOrthogonality(localMatrix);
-
-            // TODO: We're not using the GLTF code here yet, we got
-            // non-normalized rotations...
-            MTransformationMatrix mayaLocalMatrix(localMatrix);
-
-            auto &trs = state.localTransforms[0];
-
-            getTranslation(mayaLocalMatrix, trs.translation, scaleFactor, posPrecision);
-            getRotation(mayaLocalMatrix, trs.rotation, dirPrecision);
-            getScaling(mayaLocalMatrix, trs.scale, sclPrecision);
-        } break;
-
-        case TransformKind::ComplexJoint: {
-            auto &parentTransform = getTransform(node->parentNode, scaleFactor, posPrecision, sclPrecision, dirPrecision);
-            auto &parentPrimaryTRS = parentTransform.primaryTRS();
-            double parentScale[3] = {parentPrimaryTRS.scale[0],
-                                     parentPrimaryTRS.scale[1],
-                                     parentPrimaryTRS.scale[2]};
-
-            // The local matrix = scale * rotation * inverse-parent-scale *
-            // translation Extract and clear the translation, undo  the inverse
-            // parent scale, and extract rotation and scale.
-            auto m = localMatrix;
-
-            // Get translation
-            const auto t = m[3];
-            trs1.translation[0] =
-                roundToFloat(t[0] * scaleFactor, posPrecision);
-            trs1.translation[1] =
-                roundToFloat(t[1] * scaleFactor, posPrecision);
-            trs1.translation[2] =
-                roundToFloat(t[2] * scaleFactor, posPrecision);
-
-            trs1.scale[0] =
-                roundToFloat(1.0f / parentPrimaryTRS.scale[0], sclPrecision);
-            trs1.scale[1] =
-                roundToFloat(1.0f / parentPrimaryTRS.scale[1], sclPrecision);
-            trs1.scale[2] =
-                roundToFloat(1.0f / parentPrimaryTRS.scale[2], sclPrecision);
-
-            // Clear translation
-            t[0] = t[1] = t[2] = 0;
-
-            // Undo the inverse parent transform
-            double ps[4][4] = {{parentScale[0], 0, 0, 0},
-                               {0, parentScale[1], 0, 0},
-                               {0, 0, parentScale[2], 0},
-                               {0, 0, 0, 1}};
-
-            m = m * ps;
-
-            state.maxNonOrthogonality = getAxesNonOrthogonality(m);
-
-            const MTransformationMatrix mayaLocalMatrix(m);
-            getRotation(mayaLocalMatrix, trs0.rotation, dirPrecision);
-            getScaling(mayaLocalMatrix, trs0.scale, sclPrecision);
-        } break;
-
-        case TransformKind::ComplexTransform: {
-            MTransformationMatrix pivotTransformationMatrix;
-            const MVector pivotOffset = node->pivotPoint - MPoint::origin;
-            pivotTransformationMatrix.setTranslation(pivotOffset,
-                                                     MSpace::kObject);
-            const auto pivotMatrix = pivotTransformationMatrix.asMatrix();
-
-            // cout << "local matrix = " << localMatrix << endl;
-
-            // Decompose localMatrix into inverse(pivotMatrix) * innerMatrix *
-            // pivotMatrix Since we combine the pivot translation and local
-            // translation, this becomes localMatrix = inverse(pivotMatrix) *
-            // combinedMatrix
-            // => combinedMatrix = pivotMatrix * localMatrix
-            const auto combinedMatrix = pivotMatrix * localMatrix;
-
-            state.maxNonOrthogonality = getAxesNonOrthogonality(combinedMatrix);
-
-            // Inverse pivot translation node
-            trs0.translation[0] =
-                roundToFloat(-pivotOffset.x * scaleFactor, posPrecision);
-            trs0.translation[1] =
-                roundToFloat(-pivotOffset.y * scaleFactor, posPrecision);
-            trs0.translation[2] =
-                roundToFloat(-pivotOffset.z * scaleFactor, posPrecision);
-
-            // TODO: We're not using the GLTF code here yet, we got
-            // non-normalized rotations...
-            const MTransformationMatrix mayaMatrix(combinedMatrix);
-
-            // trs1: scale, rotation and translation + pivot-offset combined
-            getTranslation(mayaMatrix, trs1.translation, scaleFactor, posPrecision);
-            getRotation(mayaMatrix, trs1.rotation, dirPrecision);
-            getScaling(mayaMatrix, trs1.scale, sclPrecision);
-        } break;
-
-        default:
-            throw std::runtime_error("Unsupported node transform kind");
-        }
+    state.requiresExtraNode = node->transformKind != TransformKind::Simple;
+
+    switch (node->transformKind) {
+    case TransformKind::Simple: {
+        const auto t = localMatrix[3];
+        trs0.translation[0] = roundToFloat(t[0] * scaleFactor, posPrecision);
+        trs0.translation[1] = roundToFloat(t[1] * scaleFactor, posPrecision);
+        trs0.translation[2] = roundToFloat(t[2] * scaleFactor, posPrecision);
+
+        return localMatrix;
     }
 
-    state.isInitialized = 1;
+    case TransformKind::ComplexJoint: {
+        // The local matrix = scale * rotation * inverse-parent-scale *
+        // translation Extract and clear the translation, undo  the inverse
+        // parent scale, and extract rotation and scale.
+        auto m = localMatrix;
 
-    return state;
+        // Get translation
+        const auto t = m[3];
+        trs1.translation[0] = roundToFloat(t[0] * scaleFactor, posPrecision);
+        trs1.translation[1] = roundToFloat(t[1] * scaleFactor, posPrecision);
+        trs1.translation[2] = roundToFloat(t[2] * scaleFactor, posPrecision);
+
+        trs1.scale[0] = roundToFloat(1.0f / parentScale[0], sclPrecision);
+        trs1.scale[1] = roundToFloat(1.0f / parentScale[1], sclPrecision);
+        trs1.scale[2] = roundToFloat(1.0f / parentScale[2], sclPrecision);
+
+        // Clear translation
+        t[0] = t[1] = t[2] = 0;
+
+        // Undo the inverse parent transform
+        double ps[4][4] = {{parentScale[0], 0, 0, 0},
+                           {0, parentScale[1], 0, 0},
+                           {0, 0, parentScale[2], 0},
+                           {0, 0, 0, 1}};
+
+        return m * ps;
+    }
+
+    case TransformKind::ComplexTransform: {
+        MTransformationMatrix pivotTransformationMatrix;
+        const MVector pivotOffset = node->pivotPoint - MPoint::origin;
+        pivotTransformationMatrix.setTranslation(pivotOffset,
+                                                 MSpace::kObject);
+        const auto pivotMatrix = pivotTransformationMatrix.asMatrix();
+
+        // Decompose localMatrix into inverse(pivotMatrix) * innerMatrix *
+        // pivotMatrix Since we combine the pivot translation and local
+        // translation, this becomes localMatrix = inverse(pivotMatrix) *
+        // combinedMatrix
+        // => combinedMatrix = pivotMatrix * localMatrix
+        const auto combinedMatrix = pivotMatrix * localMatrix;
+
+        // Inverse pivot translation node
+        trs0.translation[0] =
+            roundToFloat(-pivotOffset.x * scaleFactor, posPrecision);
+        trs0.translation[1] =
+            roundToFloat(-pivotOffset.y * scaleFactor, posPrecision);
+        trs0.translation[2] =
+            roundToFloat(-pivotOffset.z * scaleFactor, posPrecision);
+
+        // trs1: scale, rotation and translation + pivot-offset combined
+        const auto t = combinedMatrix[3];
+        trs1.translation[0] = roundToFloat(t[0] * scaleFactor, posPrecision);
+        trs1.translation[1] = roundToFloat(t[1] * scaleFactor, posPrecision);
+        trs1.translation[2] = roundToFloat(t[2] * scaleFactor, posPrecision);
+
+        return combinedMatrix;
+    }
+
+    default:
+        throw std::runtime_error("Unsupported node transform kind");
+    }
+}
+
+void NodeTransformCache::decomposeRotationScale(
+    const MMatrix &matrix, GLTF::Node::TransformTRS &trs,
+    NodeTransformState &state, const double sclPrecision,
+    const double dirPrecision) {
+    state.maxNonOrthogonality = getAxesNonOrthogonality(matrix);
+
+    // TODO: We're not using the GLTF code here yet, we got
+    // non-normalized rotations...
+    const MTransformationMatrix mayaMatrix(matrix);
+    getRotation(mayaMatrix, trs.rotation, dirPrecision);
+    getScaling(mayaMatrix, trs.scale, sclPrecision);
+}
+
+const MMatrix &
+NodeTransformCache::getWorldMatrixInverse(const ExportableNode *node) {
+    const auto index = node->index;
+
+    if (index >= m_worldMatrixInverses.size()) {
+        m_worldMatrixInverses.resize(index + 1);
+        m_inverseGenerations.resize(index + 1, 0);
+    }
+
+    auto &inverse = m_worldMatrixInverses[index];
+
+    if (m_inverseGenerations[index] != m_generation) {
+        assert(m_generations.at(index) == m_generation);
+        inverse = m_states[index].worldMatrix.inverse();
+        m_inverseGenerations[index] = m_generation;
+    }
+
+    return inverse;
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "TransformBatch.h"
+
 const double MAX_NON_ORTHOGONALITY = 1e-4f;
 
 // How much the axes deviate from being orthogonal
@@ -65,6 +67,9 @@ class NodeTransformState {
     // the second will be the identity.
     NodeTransformArray localTransforms;
 
+    // The Maya world matrix of the node
+    MMatrix worldMatrix;
+
     // For Maya joints with SSC, the GLTF transform storing the rotation and
     // scale For Maya transforms with pivot points, the GLTF transform storing
     // the negative pivot offset Otherwise the GLTF transform storing the
@@ -89,19 +94,81 @@ class NodeTransformState {
     int isInitialized = 0;
 };
 
+// Caches the transform state of each node, indexed by ExportableNode::index.
+// The cache is meant to be reused for many samples, see reset.
 class NodeTransformCache {
   public:
-    NodeTransformCache() = default;
+    NodeTransformCache();
     ~NodeTransformCache() = default;
 
+    // Invalidates all cached transforms, without releasing memory
+    void reset() { ++m_generation; }
+
     const NodeTransformState &getTransform(const ExportableNode *node,
                                            double scaleFactor,
                                            const double posPrecision,
                                            const double sclPrecision,
                                            const double dirPrecision);
 
+    // Computes the transforms of all given nodes at once, decomposing their
+    // matrices in batches. The nodes must be sorted parent first.
+    // Afterwards, getTransform is just a lookup for these nodes.
+    void evaluate(gsl::span<const ExportableNode *const> nodes,
+                  double scaleFactor, double posPrecision,
+                  double sclPrecision, double dirPrecision);
+
   private:
     DISALLOW_COPY_MOVE_ASSIGN(NodeTransformCache);
 
-    std::unordered_map<const ExportableNode *, NodeTransformState> m_table;
+    std::vector<NodeTransformState> m_states;
+
+    // The generation in which each state was computed.
+    // A state is only valid when it matches the current generation.
+    std::vector<size_t> m_generations;
+    size_t m_generation = 1;
+
+    // The inverse world matrices, only computed for the logical parents that need them.
+    std::vector<MMatrix> m_worldMatrixInverses;
+    std::vector<size_t> m_inverseGenerations;
+
+    // The nodes of the batch being evaluated, with their local matrices, and
+    // the level in which they are decomposed.
+    std::vector<const ExportableNode *> m_pendingNodes;
+    std::vector<MMatrix> m_localMatrices;
+    std::vector<size_t> m_levels;
+
+    TransformBatch m_batch;
+    std::vector<const ExportableNode *> m_batchNodes;
+    std::vector<MMatrix> m_batchMatrices;
+
+    const MMatrix &getWorldMatrixInverse(const ExportableNode *node);
+
+    bool isPending(const ExportableNode *node) const;
+
+    // The index of the local transform that stores the rotation and scale
+    static size_t rotationScaleIndex(const ExportableNode *node);
+
+    // Returns the world matrix of the node, and its local matrix relative to
+    // the parent node.
+    MMatrix computeMatrices(const ExportableNode *node,
+                            const MMatrix &parentWorldMatrix,
+                            MMatrix &localMatrix);
+
+    // Sets the translations of the local transforms, and returns the matrix
+    // to extract the rotation and scale from.
+    static MMatrix prepareTransform(const ExportableNode *node,
+                                    const MMatrix &localMatrix,
+                                    const float *parentScale,
+                                    NodeTransformState &state,
+                                    double scaleFactor, double posPrecision,
+                                    double sclPrecision);
+
+    static void decomposeRotationScale(const MMatrix &matrix,
+                                       GLTF::Node::TransformTRS &trs,
+                                       NodeTransformState &state,
+                                       double sclPrecision,
+                                       double dirPrecision);
+
+    // The transform of the world (aka the parent of root nodes)
+    NodeTransformState m_worldState;
 };
@@ -0,0 +1,175 @@
+#include "externals.h"
+
+#include "TransformBatch.h"
+
+void TransformBatch::clear() {
+    for (auto &elements : m_elements) {
+        elements.clear();
+    }
+
+    m_nonOrthogonalities.clear();
+    m_isRegular.clear();
+
+    for (auto &scales : m_scales) {
+        scales.clear();
+    }
+
+    for (auto &rotations : m_rotations) {
+        rotations.clear();
+    }
+}
+
+size_t TransformBatch::add(const double *row0, const double *row1, const double *row2) {
+    const auto index = size();
+
+    const double *rows[3] = {row0, row1, row2};
+
+    for (size_t row = 0; row < 3; ++row) {
+        for (size_t column = 0; column < 3; ++column) {
+            m_elements[row * 3 + column].push_back(rows[row][column]);
+        }
+    }
+
+    m_nonOrthogonalities.push_back(0);
+    m_isRegular.push_back(0);
+
+    for (auto &scales : m_scales) {
+        scales.push_back(1);
+    }
+
+    for (auto &rotations : m_rotations) {
+        rotations.push_back(0);
+    }
+
+    return index;
+}
+
+static double dot(const double ax, const double ay, const double az, const double bx, const double by, const double bz) {
+    return ax * bx + ay * by + az * bz;
+}
+
+static float roundedFloat(const double v, const double precision) {
+    const auto f = static_cast<float>(std::round(v * precision) / precision);
+    return f == -0 ? +0 : f;
+}
+
+void TransformBatch::decompose(const double maxNonOrthogonality, const double sclPrecision, const double dirPrecision) {
+    const auto count = size();
+
+    const auto *m00 = m_elements[0].data();
+    const auto *m01 = m_elements[1].data();
+    const auto *m02 = m_elements[2].data();
+    const auto *m10 = m_elements[3].data();
+    const auto *m11 = m_elements[4].data();
+    const auto *m12 = m_elements[5].data();
+    const auto *m20 = m_elements[6].data();
+    const auto *m21 = m_elements[7].data();
+    const auto *m22 = m_elements[8].data();
+
+    auto *nonOrthogonalities = m_nonOrthogonalities.data();
+    auto *isRegular = m_isRegular.data();
+
+    auto *sx = m_scales[0].data();
+    auto *sy = m_scales[1].data();
+    auto *sz = m_scales[2].data();
+
+    auto *qx = m_rotations[0].data();
+    auto *qy = m_rotations[1].data();
+    auto *qz = m_rotations[2].data();
+    auto *qw = m_rotations[3].data();
+
+    for (size_t i = 0; i < count; ++i) {
+        const auto l0 = std::sqrt(dot(m00[i], m01[i], m02[i], m00[i], m01[i], m02[i]));
+        const auto l1 = std::sqrt(dot(m10[i], m11[i], m12[i], m10[i], m11[i], m12[i]));
+        const auto l2 = std::sqrt(dot(m20[i], m21[i], m22[i], m20[i], m21[i], m22[i]));
+
+        // Same as getAxesNonOrthogonality
+        const auto d01 = std::abs(dot(m00[i], m01[i], m02[i], m10[i], m11[i], m12[i])) / (l0 * l1);
+        const auto d12 = std::abs(dot(m10[i], m11[i], m12[i], m20[i], m21[i], m22[i])) / (l1 * l2);
+        const auto d20 = std::abs(dot(m20[i], m21[i], m22[i], m00[i], m01[i], m02[i])) / (l2 * l0);
+        const auto nonOrthogonality = std::max(d01, std::max(d12, d20));
+
+        // Orthonormalize the rows (Gram-Schmidt), the scale is the length of each row along its orthonormal axis.
+        const auto u0x = m00[i] / l0;
+        const auto u0y = m01[i] / l0;
+        const auto u0z = m02[i] / l0;
+
+        const auto p10 = dot(m10[i], m11[i], m12[i], u0x, u0y, u0z);
+        const auto v1x = m10[i] - p10 * u0x;
+        const auto v1y = m11[i] - p10 * u0y;
+        const auto v1z = m12[i] - p10 * u0z;
+        const auto scaleY = std::sqrt(dot(v1x, v1y, v1z, v1x, v1y, v1z));
+
+        const auto u1x = v1x / scaleY;
+        const auto u1y = v1y / scaleY;
+        const auto u1z = v1z / scaleY;
+
+        const auto u2x = u0y * u1z - u0z * u1y;
+        const auto u2y = u0z * u1x - u0x * u1z;
+        const auto u2z = u0x * u1y - u0y * u1x;
+
+        // Negative for mirrored matrices
+        const auto scaleZ = dot(m20[i], m21[i], m22[i], u2x, u2y, u2z);
+
+        // Rotation matrix to quaternion, using the largest component for precision.
+        // In the column-vector convention, element [r][c] is u_c[r].
+        const auto t0 = 1 + u0x + u1y + u2z;
+        const auto t1 = 1 + u0x - u1y - u2z;
+        const auto t2 = 1 - u0x + u1y - u2z;
+        const auto t3 = 1 - u0x - u1y + u2z;
+
+        const auto useW = t0 >= t1 && t0 >= t2 && t0 >= t3;
+        const auto useX = !useW && t1 >= t2 && t1 >= t3;
+        const auto useY = !useW && !useX && t2 >= t3;
+
+        const auto t = useW ? t0 : useX ? t1 : useY ? t2 : t3;
+        const auto s = 0.5 / std::sqrt(std::max(t, 1e-30));
+
+        const auto wx = u1z - u2y;
+        const auto wy = u2x - u0z;
+        const auto wz = u0y - u1x;
+        const auto xy = u1x + u0y;
+        const auto xz = u2x + u0z;
+        const auto yz = u2y + u1z;
+
+        auto x = (useW ? wx : useX ? t : useY ? xy : xz) * s;
+        auto y = (useW ? wy : useX ? xy : useY ? t : yz) * s;
+        auto z = (useW ? wz : useX ? xz : useY ? yz : t) * s;
+        auto w = (useW ? t : useX ? wx : useY ? wy : wz) * s;
+
+        // Keep the real part positive
+        const auto sign = w < 0 ? -1.0 : 1.0;
+
+        x = std::round(x * sign * dirPrecision) / dirPrecision;
+        y = std::round(y * sign * dirPrecision) / dirPrecision;
+        z = std::round(z * sign * dirPrecision) / dirPrecision;
+        w = std::round(w * sign * dirPrecision) / dirPrecision;
+
+        const auto n = std::sqrt(x * x + y * y + z * z + w * w);
+
+        qx[i] = static_cast<float>(x / n);
+        qy[i] = static_cast<float>(y / n);
+        qz[i] = static_cast<float>(z / n);
+        qw[i] = static_cast<float>(w / n);
+
+        sx[i] = roundedFloat(l0, sclPrecision);
+        sy[i] = roundedFloat(scaleY, sclPrecision);
+        sz[i] = roundedFloat(scaleZ, sclPrecision);
+
+        nonOrthogonalities[i] = nonOrthogonality;
+        isRegular[i] = nonOrthogonality <= maxNonOrthogonality && scaleZ > 0 && l0 > 0 && scaleY > 0;
+    }
+}
+
+void TransformBatch::getScale(const size_t index, float *scale) const {
+    scale[0] = m_scales[0][index];
+    scale[1] = m_scales[1][index];
+    scale[2] = m_scales[2][index];
+}
+
+void TransformBatch::getRotation(const size_t index, float *rotation) const {
+    rotation[0] = m_rotations[0][index];
+    rotation[1] = m_rotations[1][index];
+    rotation[2] = m_rotations[2][index];
+    rotation[3] = m_rotations[3][index];
+}
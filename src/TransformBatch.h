@@ -0,0 +1,57 @@
+#pragma once
+
+#include "macros.h"
+
+/**
+ * Decomposes a batch of 3x3 matrices into rotations and scales.
+ *
+ * The matrices are stored as structure-of-arrays, and each step is a
+ * branch-free loop over the batch, so the compiler can vectorize it.
+ *
+ * The matrices use Maya's row-vector convention: each row is a transformed axis.
+ * Only matrices that are orthogonal and not mirrored are decomposed,
+ * the others must be decomposed by the caller, see isRegular.
+ *
+ * The batch doesn't depend on Maya, so it can be benchmarked standalone.
+ */
+class TransformBatch {
+  public:
+    TransformBatch() = default;
+    ~TransformBatch() = default;
+
+    size_t size() const { return m_nonOrthogonalities.size(); }
+
+    void clear();
+
+    /** Appends a matrix, given by its first three rows, and returns its index in the batch */
+    size_t add(const double *row0, const double *row1, const double *row2);
+
+    /**
+     * Decomposes all matrices.
+     * @param maxNonOrthogonality Matrices with more skew are not regular.
+     * @param sclPrecision The precision to round the scales to.
+     * @param dirPrecision The precision to round the quaternion components to.
+     */
+    void decompose(double maxNonOrthogonality, double sclPrecision, double dirPrecision);
+
+    /** Is the matrix orthogonal within the maximum non-orthogonality, and not mirrored? If not, the rotation and scale are not valid */
+    bool isRegular(const size_t index) const { return m_isRegular[index] != 0; }
+
+    /** How much the axes deviate from being orthogonal, see getAxesNonOrthogonality */
+    double nonOrthogonality(const size_t index) const { return m_nonOrthogonalities[index]; }
+
+    void getScale(size_t index, float *scale) const;
+    void getRotation(size_t index, float *rotation) const;
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(TransformBatch);
+
+    // Element [row * 3 + column] of each matrix
+    std::array<std::vector<double>, 9> m_elements;
+
+    std::vector<double> m_nonOrthogonalities;
+    std::vector<uint8_t> m_isRegular;
+
+    std::array<std::vector<float>, 3> m_scales;
+    std::array<std::vector<float>, 4> m_rotations;
+};
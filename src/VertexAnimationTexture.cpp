@@ -0,0 +1,106 @@
+#include "externals.h"
+
+#include "VertexAnimationTexture.h"
+
+VertexAnimationTexture::VertexAnimationTexture(const size_t vertexCount, const size_t frameCount, const bool isDirection)
+    : vertexCount(vertexCount), frameCount(frameCount), isDirection(isDirection), m_vectors(vertexCount * frameCount * 3) {}
+
+gsl::span<float> VertexAnimationTexture::frameVectors(const size_t frameIndex) {
+    return gsl::make_span(m_vectors).subspan(frameIndex * vertexCount * 3, vertexCount * 3);
+}
+
+uint16_t VertexAnimationTexture::toFloat16(const float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t biasedExponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // Infinity and NaN
+    if (biasedExponent == 0xff)
+        return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+    const int exponent = static_cast<int>(biasedExponent) - 127 + 15;
+
+    // Too large, becomes infinity
+    if (exponent >= 31)
+        return static_cast<uint16_t>(sign | 0x7c00);
+
+    // Too small even for a subnormal half, becomes zero
+    if (exponent < -10)
+        return static_cast<uint16_t>(sign);
+
+    // Subnormal halves have an implicit leading 1 in their mantissa
+    const uint32_t shift = exponent <= 0 ? 14 - exponent : 13;
+    if (exponent <= 0) {
+        mantissa |= 0x800000;
+    }
+
+    uint32_t half = (exponent <= 0 ? 0 : static_cast<uint32_t>(exponent) << 10) | (mantissa >> shift);
+
+    // Round to nearest even, a carry into the exponent is still correct.
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+        ++half;
+    }
+
+    return static_cast<uint16_t>(sign | half);
+}
+
+static uint8_t toUnorm8(const double value) { return static_cast<uint8_t>(std::lround(std::min(1.0, std::max(0.0, value)) * 255)); }
+
+void VertexAnimationTexture::pack(const VertexAnimationFormat format) {
+    const auto rowLength = width();
+    const auto texelsPerFrame = rowsPerFrame() * rowLength;
+    const auto wordsPerTexel = format == VertexAnimationFormat::Float16 ? 2 : 1;
+
+    m_min = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    m_max = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+
+    for (size_t index = 0; index < m_vectors.size(); index += 3) {
+        for (size_t c = 0; c < 3; ++c) {
+            m_min[c] = std::min(m_min[c], m_vectors[index + c]);
+            m_max[c] = std::max(m_max[c], m_vectors[index + c]);
+        }
+    }
+
+    if (m_vectors.empty()) {
+        m_min = {0, 0, 0};
+        m_max = {0, 0, 0};
+    }
+
+    // The texels of the padding at the end of each frame stay zero.
+    m_texels.assign(frameCount * texelsPerFrame * wordsPerTexel, 0);
+
+    const float w = isDirection ? 0.0f : 1.0f;
+
+    for (size_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+        const auto *vectors = &m_vectors[frameIndex * vertexCount * 3];
+        auto *texels = &m_texels[frameIndex * texelsPerFrame * wordsPerTexel];
+
+        for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+            const auto *v = &vectors[vertexIndex * 3];
+            auto *texel = &texels[vertexIndex * wordsPerTexel];
+
+            if (format == VertexAnimationFormat::Float16) {
+                texel[0] = toFloat16(v[0]) | static_cast<uint32_t>(toFloat16(v[1])) << 16;
+                texel[1] = toFloat16(v[2]) | static_cast<uint32_t>(toFloat16(w)) << 16;
+            } else {
+                uint32_t rgba = static_cast<uint32_t>(toUnorm8(w)) << 24;
+
+                for (size_t c = 0; c < 3; ++c) {
+                    const double range = m_max[c] - m_min[c];
+                    const double unit = isDirection ? v[c] * 0.5 + 0.5 : range > 0 ? (v[c] - m_min[c]) / range : 0;
+                    rgba |= static_cast<uint32_t>(toUnorm8(unit)) << (c * 8);
+                }
+
+                texel[0] = rgba;
+            }
+        }
+    }
+
+    // The samples are not needed anymore
+    m_vectors = std::vector<float>();
+}
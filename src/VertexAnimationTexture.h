@@ -0,0 +1,62 @@
+#pragma once
+
+#include "macros.h"
+
+/** How vertex animation textures store their texels */
+enum class VertexAnimationFormat {
+    /** No vertex animation textures are exported */
+    None,
+    /** RGBA texels with 16-bit floating point components */
+    Float16,
+    /** RGBA texels with 8-bit components, quantized to the range of the texture */
+    RGBA8
+};
+
+/**
+ * The sampled positions or normals of the vertices of a primitive over the frames of a clip,
+ * packed into the texels of a vertex animation texture.
+ *
+ * Each frame fills rowsPerFrame rows of the texture, with one texel per vertex.
+ * The RGB components of a texel store the vector, A is 1 for positions and 0 for normals.
+ * RGBA8 positions are quantized to the range min to max, normals to the range -1 to 1.
+ *
+ * The texture doesn't depend on Maya, so it can be benchmarked standalone.
+ */
+class VertexAnimationTexture {
+  public:
+    VertexAnimationTexture(size_t vertexCount, size_t frameCount, bool isDirection);
+    ~VertexAnimationTexture() = default;
+
+    static constexpr size_t maxWidth = 8192;
+
+    const size_t vertexCount;
+    const size_t frameCount;
+    const bool isDirection;
+
+    size_t width() const { return std::min(vertexCount, maxWidth); }
+    size_t rowsPerFrame() const { return (vertexCount + maxWidth - 1) / maxWidth; }
+    size_t height() const { return frameCount * rowsPerFrame(); }
+
+    /** The XYZ components of all vertices at the given frame, to be filled by the sampler */
+    gsl::span<float> frameVectors(size_t frameIndex);
+
+    /** Quantizes the samples into texels, and releases the samples */
+    void pack(VertexAnimationFormat format);
+
+    /** The packed texels, padded to 4 bytes */
+    gsl::span<const uint32_t> texels() const { return gsl::make_span(m_texels); }
+
+    const std::array<float, 3> &min() const { return m_min; }
+    const std::array<float, 3> &max() const { return m_max; }
+
+    static uint16_t toFloat16(float value);
+
+  private:
+    DISALLOW_COPY_MOVE_ASSIGN(VertexAnimationTexture);
+
+    std::vector<float> m_vectors;
+    std::vector<uint32_t> m_texels;
+
+    std::array<float, 3> m_min{};
+    std::array<float, 3> m_max{};
+};
@@ -0,0 +1,66 @@
+#include "externals.h"
+
+#include "filesystem.h"
+#include "outputFiles.h"
+
+bool hasFileContent(const std::string &path, const FileContent &content) {
+    size_t contentLength = 0;
+    for (auto &range : content) {
+        contentLength += range.size();
+    }
+
+    // Most changed files differ in size, so don't read these.
+    std::error_code errorCode;
+    const auto fileLength = fs::file_size(path, errorCode);
+    if (errorCode || fileLength != contentLength)
+        return false;
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::vector<char> chunk(256 * 1024);
+
+    for (auto &range : content) {
+        for (size_t offset = 0; offset < static_cast<size_t>(range.size());) {
+            const auto length = std::min(chunk.size(), static_cast<size_t>(range.size()) - offset);
+
+            if (!file.read(chunk.data(), length) || std::memcmp(chunk.data(), range.data() + offset, length) != 0)
+                return false;
+
+            offset += length;
+        }
+    }
+
+    return true;
+}
+
+std::string temporaryFilePath(const std::string &path) { return path + ".tmp"; }
+
+bool writeChangedFile(const std::string &path, const FileContent &content) {
+    if (hasFileContent(path, content))
+        return false;
+
+    const auto tempPath = temporaryFilePath(path);
+
+    {
+        std::ofstream file(tempPath, std::ios::out | std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Couldn't write to '" + tempPath + "'");
+
+        for (auto &range : content) {
+            file.write(reinterpret_cast<const char *>(range.data()), range.size());
+        }
+
+        file.close();
+
+        if (!file) {
+            std::error_code errorCode;
+            fs::remove(tempPath, errorCode);
+            throw std::runtime_error("Failed to write '" + tempPath + "'");
+        }
+    }
+
+    fs::rename(tempPath, path);
+    return true;
+}
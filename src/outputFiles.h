@@ -0,0 +1,17 @@
+#pragma once
+
+/** The content of an output file, as consecutive byte ranges */
+typedef std::vector<gsl::span<const uint8_t>> FileContent;
+
+/** Does the file at the path already have exactly this content? */
+extern bool hasFileContent(const std::string &path, const FileContent &content);
+
+/** A path next to the given path, to write a file to before it replaces the file at the given path */
+extern std::string temporaryFilePath(const std::string &path);
+
+/**
+ * Writes the content to the file at the path, unless the file already has this content.
+ * The content is written to a temporary file first, which then replaces the file, so readers never see a partial file.
+ * Returns false when the file was unchanged.
+ */
+extern bool writeChangedFile(const std::string &path, const FileContent &content);
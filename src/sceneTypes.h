@@ -183,3 +183,13 @@ inline Type type(const Semantic::Kind s) {
 }; // namespace Component
 
 typedef std::bitset<Semantic::COUNT> MeshSemanticSet;
+
+/** How the vertex attributes of a primitive are laid out in buffer views */
+enum class VertexBufferLayout {
+    /** Each attribute in its own buffer view region */
+    Planar,
+    /** All attributes of a vertex next to each other, in one buffer view */
+    Interleaved,
+    /** Positions planar, for depth-only passes, all other attributes interleaved */
+    PositionSplit
+};